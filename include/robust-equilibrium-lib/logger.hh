@@ -13,7 +13,9 @@
 #include <robust-equilibrium-lib/config.hh>
 #include <sstream>
 #include <Eigen/Dense>
-#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
 #include "boost/assign.hpp"
 
 namespace robust_equilibrium
@@ -25,7 +27,20 @@ namespace robust_equilibrium
 //#define LOGGER_VERBOSITY_ALL
 #define LOGGER_VERBOSITY_ALL
 
-#define SEND_MSG(msg,type)         getLogger().sendMsg(msg,type,__FILE__,__LINE__)
+/** Send a message to the logger. The verbosity is checked before evaluating msg,
+ * so the message string is built only if it is going to be printed.
+ * Each call site gets a unique id the first time it is executed, which is used
+ * to throttle streaming messages.
+ */
+#define SEND_MSG(msg,type)                                                                \
+  do {                                                                                    \
+    robust_equilibrium::Logger& _logger = robust_equilibrium::getLogger();                \
+    if(_logger.isEnabled(type))                                                           \
+    {                                                                                     \
+      static const unsigned int _msg_id = robust_equilibrium::Logger::getNewMsgId();      \
+      _logger.sendMsg(msg,type,_msg_id,__FILE__,__LINE__);                                \
+    }                                                                                     \
+  } while(0)
 
 #ifdef LOGGER_VERBOSITY_ERROR
 #define SEND_DEBUG_MSG(msg)
@@ -44,7 +59,7 @@ namespace robust_equilibrium
 #define SEND_WARNING_MSG(msg)         SEND_MSG(msg,MSG_TYPE_WARNING)
 #define SEND_ERROR_MSG(msg)           SEND_MSG(msg,MSG_TYPE_ERROR)
 #define SEND_DEBUG_STREAM_MSG(msg)
-#define SEND_INFO_STREAM_MSG(msg)\
+#define SEND_INFO_STREAM_MSG(msg)
 #define SEND_WARNING_STREAM_MSG(msg)  SEND_MSG(msg,MSG_TYPE_WARNING_STREAM)
 #define SEND_ERROR_STREAM_MSG(msg)    SEND_MSG(msg,MSG_TYPE_ERROR_STREAM)
 #endif
@@ -138,12 +153,28 @@ namespace robust_equilibrium
            * to decrement the internal Logger's counter. */
     void countdown();
 
+    /** Return true if the current verbosity level allows printing messages of the specified type. */
+    inline bool isEnabled(MsgType type) const
+    {
+      switch(m_lv.load(std::memory_order_relaxed))
+      {
+      case VERBOSITY_ALL:                 return true;
+      case VERBOSITY_INFO_WARNING_ERROR:  return !isDebugMsg(type);
+      case VERBOSITY_WARNING_ERROR:       return isWarningMsg(type) || isErrorMsg(type);
+      case VERBOSITY_ERROR:               return isErrorMsg(type);
+      default:                            return false;
+      }
+    }
+
     /** Print the specified message on standard output if the verbosity level
-         * allows it. The file name and the line number are used to identify
-         * the point where sendMsg is called so that streaming messages are
+         * allows it. The id identifies the point where sendMsg is called
+         * (see getNewMsgId) so that streaming messages are
          * printed only every streamPrintPeriod iterations.
          */
-    void sendMsg(std::string msg, MsgType type, const char* file="", int line=0);
+    void sendMsg(const std::string& msg, MsgType type, unsigned int id, const char* file="", int line=0);
+
+    /** Return a new unique id to identify a call site of sendMsg. */
+    static unsigned int getNewMsgId();
 
     /** Set the sampling time at which the method countdown()
            * is going to be called. */
@@ -152,31 +183,35 @@ namespace robust_equilibrium
     /** Set the time period for printing of streaming messages. */
     bool setStreamPrintPeriod(double s);
 
-    /** Set the verbosity level of the logger. */
+    /** Set the verbosity level of the logger. This can be changed at any time, from any thread. */
     void setVerbosity(LoggerVerbosity lv);
 
+    /** Get the verbosity level of the logger. */
+    LoggerVerbosity getVerbosity() const;
+
   protected:
-    LoggerVerbosity m_lv;                /// verbosity of the logger
+    std::atomic<LoggerVerbosity> m_lv;   /// verbosity of the logger
     double          m_timeSample;        /// specify the period of call of the countdown method
     double          m_streamPrintPeriod; /// specify the time period of the stream prints
     double          m_printCountdown;    /// every time this is < 0 (i.e. every _streamPrintPeriod sec) print stuff
 
-    /** Pointer to the dynamic structure which holds the collection of streaming messages */
-    std::map<std::string, double> m_stream_msg_counters;
+    /** Counters of the streaming messages, indexed by call-site id */
+    std::vector<double> m_stream_msg_counters;
+    std::mutex          m_stream_msg_mutex;   /// protects m_stream_msg_counters
 
-    bool isStreamMsg(MsgType m)
+    static bool isStreamMsg(MsgType m)
     { return m==MSG_TYPE_ERROR_STREAM || m==MSG_TYPE_DEBUG_STREAM || m==MSG_TYPE_INFO_STREAM || m==MSG_TYPE_WARNING_STREAM; }
 
-    bool isDebugMsg(MsgType m)
+    static bool isDebugMsg(MsgType m)
     { return m==MSG_TYPE_DEBUG_STREAM || m==MSG_TYPE_DEBUG; }
 
-    bool isInfoMsg(MsgType m)
+    static bool isInfoMsg(MsgType m)
     { return m==MSG_TYPE_INFO_STREAM || m==MSG_TYPE_INFO; }
 
-    bool isWarningMsg(MsgType m)
+    static bool isWarningMsg(MsgType m)
     { return m==MSG_TYPE_WARNING_STREAM || m==MSG_TYPE_WARNING; }
 
-    bool isErrorMsg(MsgType m)
+    static bool isErrorMsg(MsgType m)
     { return m==MSG_TYPE_ERROR_STREAM || m==MSG_TYPE_ERROR; }
   };
 
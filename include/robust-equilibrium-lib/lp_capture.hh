@@ -0,0 +1,125 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef ROBUST_EQUILIBRIUM_LIB_LP_CAPTURE_HH
+#define ROBUST_EQUILIBRIUM_LIB_LP_CAPTURE_HH
+
+#include <robust-equilibrium-lib/config.hh>
+#include <robust-equilibrium-lib/util.hh>
+#include <robust-equilibrium-lib/solver_LP_abstract.hh>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+
+namespace robust_equilibrium
+{
+
+/**
+ * @brief Options of the LP capture (see Solver_LP_abstract::startLpCapture).
+ * An LP is captured if it satisfies at least one of the enabled filters.
+ */
+struct ROBUST_EQUILIBRIUM_DLLAPI LpCaptureOptions
+{
+  LpCaptureOptions()
+    : bufferSize(64*1024*1024), samplingPeriod(0), slowThreshold(0.0), captureFailed(true) {}
+
+  size_t        bufferSize;     /// size of the in-memory ring buffer [bytes]
+  unsigned int  samplingPeriod; /// capture one LP every samplingPeriod solves (0 disables sampling)
+  double        slowThreshold;  /// capture the LPs that took longer than this to solve [s] (<=0 disables)
+  bool          captureFailed;  /// capture the LPs whose status is not LP_STATUS_OPTIMAL
+};
+
+/**
+ * @brief An LP read from a capture file.
+ *  minimize    c' x
+ *  subject to  Alb <= A x <= Aub
+ *              lb <= x <= ub
+ */
+struct ROBUST_EQUILIBRIUM_DLLAPI CapturedLp
+{
+  VectorX   c, lb, ub;
+  MatrixXX  A;
+  VectorX   Alb, Aub;
+  VectorX   sol;        /// solution returned by the solver
+  LP_status status;     /// status returned by the solver
+  double    solveTime;  /// time taken by the solver [s]
+};
+
+/**
+ * @brief Append-only binary file of LPs, written asynchronously.
+ * The LPs are serialized into a preallocated ring buffer, which is written to the file
+ * by a background thread. If the buffer is full the LP is dropped rather than waiting,
+ * so that the solvers are never slowed down by the disk.
+ * Each record contains a header (magic number, size, status, solve time, n, m) followed
+ * by c, lb, ub, A (row major), Alb, Aub and the solution, all in double precision.
+ */
+class ROBUST_EQUILIBRIUM_DLLAPI LpCapture
+{
+public:
+  /** Open the file (in append mode) and start the writing thread. */
+  LpCapture(const std::string& filename, const LpCaptureOptions& options);
+
+  /** Write all the buffered LPs, stop the writing thread and close the file. */
+  ~LpCapture();
+
+  /** Return true if the file has been opened correctly. */
+  bool isOpen() const { return m_file!=NULL; }
+
+  /** Return true if an LP with the specified solve time and status passes the filters.
+   * This also advances the sampling counter, so it must be called once per solve. */
+  bool shouldCapture(double solveTime, LP_status status);
+
+  /** Add the specified LP to the buffer.
+   * @return False if the LP has been dropped because the buffer is full. */
+  bool capture(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+               Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub,
+               Cref_vectorX sol, LP_status status, double solveTime);
+
+  /** Wait until all the buffered LPs have been written to the file. */
+  void flush();
+
+  /** Number of LPs added to the buffer. */
+  unsigned long getNumberOfCapturedLps() const { return m_captured; }
+
+  /** Number of LPs dropped because the buffer was full. */
+  unsigned long getNumberOfDroppedLps() const { return m_dropped; }
+
+  /** Read all the LPs contained in the specified capture file.
+   * @return False if the file could not be opened or if it contains a corrupted record,
+   * in which case lps contains the LPs read before the corrupted one. */
+  static bool readFile(const std::string& filename, std::vector<CapturedLp>& lps);
+
+private:
+  /** Copy size bytes into the ring buffer starting from position pos, wrapping around. */
+  size_t copyToBuffer(size_t pos, const void* data, size_t size);
+
+  /** Copy n values into the ring buffer in double precision, returning the position after them. */
+  size_t copyValuesToBuffer(size_t pos, const value_type* data, size_t n);
+
+  /** Loop of the writing thread. */
+  void writerLoop();
+
+  LpCaptureOptions          m_options;
+  FILE*                     m_file;
+  std::vector<char>         m_buffer;
+  size_t                    m_readPos;    /// position of the first byte not yet written to file
+  size_t                    m_used;       /// number of bytes in the buffer (being written or not)
+  bool                      m_stop;       /// true when the writing thread must terminate
+  std::mutex                m_mutex;      /// protects m_readPos, m_used and m_stop
+  std::condition_variable   m_dataReady;  /// notified when data is added or m_stop is set
+  std::condition_variable   m_dataWritten;/// notified when data has been written
+  std::thread               m_writer;
+  std::atomic<unsigned long>  m_solves;   /// number of calls to shouldCapture, used for sampling
+  std::atomic<unsigned long>  m_captured;
+  std::atomic<unsigned long>  m_dropped;
+};
+
+} // end namespace robust_equilibrium
+
+#endif //ROBUST_EQUILIBRIUM_LIB_LP_CAPTURE_HH
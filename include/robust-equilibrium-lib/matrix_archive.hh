@@ -0,0 +1,186 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef ROBUST_EQUILIBRIUM_LIB_MATRIX_ARCHIVE_HH
+#define ROBUST_EQUILIBRIUM_LIB_MATRIX_ARCHIVE_HH
+
+#include <robust-equilibrium-lib/config.hh>
+#include <robust-equilibrium-lib/util.hh>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <stdint.h>
+
+namespace robust_equilibrium
+{
+
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_ALIGNMENT 64
+
+/**
+ * Binary file containing many named matrices and Linear Programs.
+ *
+ * Layout (version 1):
+ *  - header: magic "REQLARCH", version, endianness marker, number of entries,
+ *    offset and size of the index, checksum of the index
+ *  - data of the entries, each one starting at a multiple of ARCHIVE_ALIGNMENT bytes
+ *  - index: for each entry its name, type, size, offset and the checksum of its data
+ *
+ * All the values are stored in double precision, in row-major order and with the byte order
+ * of the machine that wrote the file (files written with a different byte order are rejected).
+ * An LP (minimize c'x subject to Alb <= A x <= Aub, lb <= x <= ub) is stored as a single
+ * block containing c, lb, ub, A, Alb and Aub.
+ * The checksums are CRC-32.
+ */
+enum ROBUST_EQUILIBRIUM_DLLAPI ArchiveEntryType
+{
+  ARCHIVE_ENTRY_MATRIX = 0,
+  ARCHIVE_ENTRY_LP     = 1
+};
+
+/** Compute the CRC-32 checksum of the specified data. */
+ROBUST_EQUILIBRIUM_DLLAPI uint32_t computeCrc32(const void* data, size_t size, uint32_t crc=0);
+
+/**
+ * @brief Write a matrix archive. The data of the entries are written as soon as they are
+ * added, while the index and the header are written by close().
+ */
+class ROBUST_EQUILIBRIUM_DLLAPI MatrixArchiveWriter
+{
+public:
+  MatrixArchiveWriter();
+
+  /** Close the file, if open. */
+  ~MatrixArchiveWriter();
+
+  /** Create the specified file, overwriting it if it exists. */
+  bool open(const std::string& filename);
+
+  /** Add a matrix with the specified name, which must be unique in the archive. */
+  bool addMatrix(const std::string& name, Cref_matrixXX matrix);
+
+  /** Add a Linear Program with the specified name, which must be unique in the archive. */
+  bool addLp(const std::string& name, Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+             Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub);
+
+  /** Write index and header and close the file.
+   * @return True if all the data have been written successfully, false otherwise. */
+  bool close();
+
+private:
+  struct Entry
+  {
+    std::string name;
+    uint32_t    type;
+    int64_t     rows, cols;
+    uint64_t    offset;
+    uint32_t    checksum;
+  };
+
+  /** Add a new entry, whose data are written by the following calls to writeData. */
+  bool beginEntry(const std::string& name, ArchiveEntryType type, int64_t rows, int64_t cols);
+  /** Write size values in double precision, converting them if value_type is float. */
+  void writeData(const value_type* values, size_t size);
+
+  FILE*                       m_file;
+  uint64_t                    m_offset;   /// current position in the file
+  bool                        m_success;  /// false if a write failed
+  std::vector<Entry>          m_entries;
+  std::map<std::string,int>   m_names;
+  std::vector<double>         m_buffer;   /// values converted to double (only with USE_FLOAT)
+};
+
+/**
+ * @brief Read a matrix archive. The file is memory mapped, and the matrices and LPs are
+ * returned as Eigen::Map views on the mapped memory, so opening an archive only reads its index
+ * and accessing an entry only reads the pages containing its data.
+ * The views remain valid until the archive is closed. They are always in double precision,
+ * also when value_type is float (readMatrix returns a converted copy).
+ */
+class ROBUST_EQUILIBRIUM_DLLAPI MatrixArchive
+{
+public:
+  typedef Eigen::Map<const MatrixXX_d> MatrixView;
+  typedef Eigen::Map<const VectorX_d>  VectorView;
+
+  /** Views on the data of an LP. */
+  struct LpView
+  {
+    LpView() : c(NULL,0), lb(NULL,0), ub(NULL,0), A(NULL,0,0), Alb(NULL,0), Aub(NULL,0) {}
+    VectorView c, lb, ub;
+    MatrixView A;
+    VectorView Alb, Aub;
+  };
+
+  MatrixArchive();
+
+  /** Unmap the file, if open. */
+  ~MatrixArchive();
+
+  /** Map the specified file in memory and read its index.
+   * @return False if the file cannot be mapped, or if its header or index are not valid
+   * (wrong magic number, version or byte order, corrupted index). */
+  bool open(const std::string& filename);
+
+  /** Unmap the file. All the views returned so far become invalid. */
+  void close();
+
+  /** Number of entries in the archive. */
+  size_t size() const { return m_entries.size(); }
+
+  /** Name of the i-th entry (entries are in the order in which they have been added). */
+  const std::string& getName(size_t i) const { return m_entries[i].name; }
+
+  /** Type of the i-th entry. */
+  ArchiveEntryType getType(size_t i) const { return (ArchiveEntryType) m_entries[i].type; }
+
+  /** Return true if the archive contains an entry with the specified name. */
+  bool contains(const std::string& name) const { return m_names.find(name)!=m_names.end(); }
+
+  /** Set view to the matrix with the specified name.
+   * @return False if there is no matrix with the specified name. */
+  bool getMatrix(const std::string& name, MatrixView& view) const;
+
+  /** Set view to the LP with the specified name.
+   * @return False if there is no LP with the specified name. */
+  bool getLp(const std::string& name, LpView& view) const;
+
+  /** Copy the matrix with the specified name into matrix. */
+  bool readMatrix(const std::string& name, MatrixXX& matrix) const;
+
+  /** Check the checksum of the data of the entry with the specified name.
+   * This reads all its data, so it is not done when the views are created. */
+  bool verify(const std::string& name) const;
+
+private:
+  struct Entry
+  {
+    std::string name;
+    uint32_t    type;
+    int64_t     rows, cols;
+    uint64_t    offset;
+    uint32_t    checksum;
+  };
+
+  /** Return the entry with the specified name and type, or NULL */
+  const Entry* find(const std::string& name, ArchiveEntryType type) const;
+
+  /** Pointer to the data of an entry */
+  const double* data(const Entry& e) const { return (const double*)(m_data+e.offset); }
+
+  const char*               m_data;   /// mapped memory
+  size_t                    m_size;   /// size of the mapped memory
+#ifdef WIN32
+  void*                     m_fileHandle;
+  void*                     m_mappingHandle;
+#endif
+  std::vector<Entry>        m_entries;
+  std::map<std::string,int> m_names;
+};
+
+} // end namespace robust_equilibrium
+
+#endif //ROBUST_EQUILIBRIUM_LIB_MATRIX_ARCHIVE_HH
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef ROBUST_EQUILIBRIUM_LIB_POLYTOPE_CACHE_HH
+#define ROBUST_EQUILIBRIUM_LIB_POLYTOPE_CACHE_HH
+
+#include <robust-equilibrium-lib/config.hh>
+#include <robust-equilibrium-lib/util.hh>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+namespace robust_equilibrium
+{
+
+/**
+ * @brief LRU cache of the polytopes computed by StaticEquilibrium with the PP algorithm,
+ * keyed by the inputs of setNewContacts (contact points and normals, friction coefficient,
+ * number of generators per contact and mass).
+ * The inputs are quantized with the specified resolution, so stances that differ by less
+ * than the resolution share the same entry. The least recently used entries are evicted when
+ * the memory used by the cache exceeds its budget.
+ * The cache can be shared among several StaticEquilibrium objects, also used by different threads.
+ */
+class ROBUST_EQUILIBRIUM_DLLAPI PolytopeCache
+{
+public:
+  /** Quantized inputs of setNewContacts */
+  struct Key
+  {
+    std::vector<int64_t> values;
+    size_t               hash;
+    bool operator==(const Key& other) const { return hash==other.hash && values==other.values; }
+  };
+
+  /** Data computed by setNewContacts with the PP algorithm */
+  struct Entry
+  {
+    MatrixXX  H;
+    VectorX   h;
+    MatrixX3  HD;
+    VectorX   Hd;
+    VectorX   HG1;
+  };
+
+  /**
+   * @brief PolytopeCache constructor.
+   * @param memoryBudget Maximum memory used by the cached entries [bytes].
+   * @param resolution Resolution used to quantize the contact inputs.
+   */
+  PolytopeCache(size_t memoryBudget=64*1024*1024, double resolution=1e-9);
+
+  /** Compute the key associated to the specified inputs of setNewContacts. */
+  Key computeKey(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals, double frictionCoefficient,
+                 unsigned int generatorsPerContact, double mass) const;
+
+  /** Copy the entry associated to key into entry and mark it as the most recently used.
+   * @return True if the key has been found, false otherwise. */
+  bool find(const Key& key, Entry& entry);
+
+  /** Add an entry, evicting the least recently used entries if the memory budget is exceeded.
+   * Entries larger than the whole budget are not added. */
+  void insert(const Key& key, const Entry& entry);
+
+  /** Remove all the entries (the counters are not reset). */
+  void clear();
+
+  /** Set the memory budget [bytes], evicting entries if necessary. */
+  void setMemoryBudget(size_t memoryBudget);
+
+  size_t getMemoryBudget() const;
+  size_t getMemoryUsage() const;
+  double getResolution() const { return m_resolution; }
+
+  /** Number of entries in the cache. */
+  size_t size() const;
+
+  unsigned long getNumberOfHits() const { return m_hits; }
+  unsigned long getNumberOfMisses() const { return m_misses; }
+  unsigned long getNumberOfEvictions() const { return m_evictions; }
+
+  /** Reset hit, miss and eviction counters. */
+  void resetCounters();
+
+private:
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const { return key.hash; }
+  };
+
+  typedef std::list<std::pair<Key, Entry> > EntryList;
+
+  /** Approximate memory used by an entry [bytes] */
+  static size_t memorySize(const Key& key, const Entry& entry);
+
+  /** Remove the least recently used entries until the memory usage is within the budget */
+  void evict();
+
+  mutable std::mutex  m_mutex;
+  size_t              m_memoryBudget;
+  size_t              m_memoryUsage;
+  double              m_resolution;
+  EntryList           m_entries;    /// from the most to the least recently used
+  std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;
+  std::atomic<unsigned long> m_hits;
+  std::atomic<unsigned long> m_misses;
+  std::atomic<unsigned long> m_evictions;
+};
+
+} // end namespace robust_equilibrium
+
+#endif //ROBUST_EQUILIBRIUM_LIB_POLYTOPE_CACHE_HH
@@ -9,6 +9,8 @@
 #include <Eigen/Dense>
 #include <robust-equilibrium-lib/config.hh>
 #include <robust-equilibrium-lib/util.hh>
+#include <atomic>
+#include <string>
 
 namespace robust_equilibrium
 {
@@ -39,6 +41,8 @@ enum ROBUST_EQUILIBRIUM_DLLAPI LP_status
 };
 
 
+struct LpCaptureOptions;
+
 /**
  * @brief Abstract interface for a Linear Program (LP) solver.
  */
@@ -49,6 +53,20 @@ protected:
   int                   m_maxIter;        // max number of iterations
   double                m_maxTime;        // max time to solve the LP [s]
 
+  static std::atomic<bool> s_lpCaptureActive; // true if the solved LPs must be passed to the LP capture
+
+  /** Return true if LP capture is active. This is cheap enough to be called at every solve. */
+  static bool isLpCaptureActive(){ return s_lpCaptureActive.load(std::memory_order_relaxed); }
+
+  /** Return true if the LP capture filters accept an LP with the specified solve time and status.
+   * Must be called once per solve, and only if isLpCaptureActive() is true. */
+  static bool shouldCaptureLp(double solveTime, LP_status status);
+
+  /** Add the specified LP to the LP capture. */
+  static void captureLp(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                        Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub,
+                        Cref_vectorX sol, LP_status status, double solveTime);
+
 public:
 
   Solver_LP_abstract()
@@ -58,6 +76,8 @@ public:
     m_useWarmStart = true;
   }
 
+  virtual ~Solver_LP_abstract(){}
+
   /**
    * @brief Create a new LP solver of the specified type.
    * @param solverType Type of LP solver.
@@ -119,16 +139,42 @@ public:
                               VectorX &c, VectorX &lb, VectorX &ub,
                               MatrixXX &A, VectorX &Alb, VectorX &Aub);
 
+  /**
+   * @brief Start capturing the LPs solved by all the solvers (see LpCapture).
+   * The LPs that pass the filters are appended to the specified binary file, together with
+   * their status, solution and solve time. They can be read back with LpCapture::readFile.
+   * If a capture is already active it is stopped first.
+   * @param filename Name of the capture file, opened in append mode.
+   * @param options Buffer size and filters.
+   * @return True if the operation succeeded, false otherwise.
+   */
+  static bool startLpCapture(const std::string& filename);
+  static bool startLpCapture(const std::string& filename, const LpCaptureOptions& options);
+
+  /** Stop capturing LPs, write the captured LPs to file and close it. */
+  static void stopLpCapture();
+
+  /** Wait until all the captured LPs have been written to file. */
+  static void flushLpCapture();
+
   /** Get the status of the solver. */
   virtual LP_status getStatus() = 0;
 
   /** Get the objective value of the last solved problem. */
   virtual double getObjectiveValue() = 0;
 
-  /** Get the value of the dual variables. */
+  /** Get the number of iterations performed to solve the last problem. */
+  virtual unsigned int getNumberOfIterations() = 0;
+
+  /** Get the value of the dual variables associated to the constraints Alb <= A x <= Aub.
+   * They satisfy c = A' res + (multipliers of the bounds lb <= x <= ub). */
   virtual void getDualSolution(Ref_vectorX res) = 0;
 
 
+  /** Release the data kept to warm start the following problems (e.g. the solvers of previous
+   * problem sizes). The next problem is solved from scratch. */
+  virtual void clearWarmStartData(){}
+
   /** Return true if the solver is allowed to warm start, false otherwise. */
   virtual bool getUseWarmStart(){ return m_useWarmStart; }
   /** Specify whether the solver is allowed to use warm-start techniques. */
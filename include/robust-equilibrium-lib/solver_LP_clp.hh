@@ -12,6 +12,8 @@
 #include <robust-equilibrium-lib/util.hh>
 #include <robust-equilibrium-lib/solver_LP_abstract.hh>
 #include "ClpSimplex.hpp"
+#include "CoinPackedMatrix.hpp"
+#include <vector>
 
 namespace robust_equilibrium
 {
@@ -21,6 +23,29 @@ class ROBUST_EQUILIBRIUM_DLLAPI Solver_LP_clp: public Solver_LP_abstract
 private:
   ClpSimplex m_model;
 
+  MatrixXX                  m_A;        // dense copy of the constraint matrix loaded in m_model
+  std::vector<double>       m_elements; // nonzero elements of the constraint matrix (column major)
+  std::vector<int>          m_rowIndex; // row index of each nonzero element
+  std::vector<CoinBigIndex> m_starts;   // index of the first nonzero element of each column
+  std::vector<int>          m_lengths;  // number of nonzero elements of each column
+  std::vector<unsigned char> m_basis;   // status of variables and constraints, used to warm start
+  VectorX_d                 m_c_d, m_lb_d, m_ub_d, m_Alb_d, m_Aub_d;  // double copies (only with USE_FLOAT)
+
+  /** Load the specified problem in m_model, keeping the current basis if warm start is
+   * allowed and the problem dimensions have not changed. */
+  void loadProblem(const CoinPackedMatrix &A, Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                   Cref_vectorX Alb, Cref_vectorX Aub);
+
+  /** Pack the nonzero elements of A column by column and load the problem in m_model. */
+  void loadDenseProblem(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                        Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub);
+
+  /** Solve the problem currently loaded in m_model and copy its solution in sol.
+   * If warm start is allowed the dual simplex starts from the current basis, which remains
+   * dual feasible when only the constraint bounds have changed. Otherwise the primal simplex
+   * starts from the slack basis. */
+  LP_status solveLoadedModel(Ref_vectorX sol);
+
 public:
 
   Solver_LP_clp();
@@ -34,12 +59,25 @@ public:
                           Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub,
                           Ref_vectorX sol);
 
+  /** Solve the linear program
+   *  minimize    c' x
+   *  subject to  Alb <= A x <= Aub
+   *              lb <= x <= ub
+   * where the constraint matrix A is given in sparse format.
+   */
+  virtual LP_status solve(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                          const CoinPackedMatrix &A, Cref_vectorX Alb, Cref_vectorX Aub,
+                          Ref_vectorX sol);
+
   /** Get the status of the solver. */
   virtual LP_status getStatus();
 
   /** Get the objective value of the last solved problem. */
   virtual double getObjectiveValue();
 
+  /** Get the number of simplex iterations performed to solve the last problem. */
+  virtual unsigned int getNumberOfIterations();
+
   /** Get the value of the dual variables. */
   virtual void getDualSolution(Ref_vectorX res);
 
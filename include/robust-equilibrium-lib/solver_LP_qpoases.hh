@@ -10,6 +10,9 @@
 #include <robust-equilibrium-lib/util.hh>
 #include <robust-equilibrium-lib/solver_LP_abstract.hh>
 #include <qpOASES.hpp>
+#include <map>
+#include <list>
+#include <utility>
 
 namespace robust_equilibrium
 {
@@ -17,12 +20,33 @@ namespace robust_equilibrium
 class ROBUST_EQUILIBRIUM_DLLAPI Solver_LP_qpoases: public Solver_LP_abstract
 {
 private:
-  qpOASES::Options    m_options;  // solver options
-  qpOASES::SQProblem  m_solver;   // qpoases solver
+  typedef std::pair<int,int> ProblemSize;  // number of variables and number of constraints
 
-  MatrixXX              m_H;              // Hessian matrix
-  bool                  m_init_succeeded; // true if solver has been successfully initialized
+  /** qpOASES solver for problems of a given size, with the data needed to warm start it. */
+  struct Problem
+  {
+    qpOASES::SQProblem  solver;         // qpoases solver
+    MatrixXX            A;              // constraint matrix of the last solved problem
+    MatrixXX_d          H;              // zero Hessian matrix, allocated only if A changes
+    bool                init_succeeded; // true if solver has been successfully initialized
+    std::list<ProblemSize>::iterator lru_position; // position of the size in m_lru
+  };
+
+  /** Solvers indexed by problem size, so that problems of different sizes can be alternated
+   * without reinitializing the solvers */
+  typedef std::map<ProblemSize, Problem> ProblemMap;
+
+  qpOASES::Options      m_options;        // solver options
+  ProblemMap            m_problems;       // solvers for the most recently used problem sizes
+  std::list<ProblemSize> m_lru;           // problem sizes, from the most to the least recently used
+  unsigned int          m_maxProblems;    // maximum number of solvers kept in m_problems
+  Problem*              m_problem;        // solver used for the last problem
+
+  VectorX_d             m_dual;           // dual solution of both bounds and constraints
+  VectorX_d             m_c_d, m_lb_d, m_ub_d, m_Alb_d, m_Aub_d, m_x_d;  // double copies (only with USE_FLOAT)
+  MatrixXX_d            m_A_d;
   qpOASES::returnValue  m_status;         // status code returned by the solver
+  int                   m_iterations;     // number of working set recalculations of the last solve
 
 public:
 
@@ -41,9 +65,24 @@ public:
   virtual LP_status getStatus();
 
   /** Get the objective value of the last solved problem. */
-  virtual double getObjectiveValue(){ return m_solver.getObjVal(); }
+  virtual double getObjectiveValue(){ return m_problem==NULL ? 0.0 : m_problem->solver.getObjVal(); }
+
+  /** Get the number of working set recalculations performed to solve the last problem. */
+  virtual unsigned int getNumberOfIterations(){ return m_iterations; }
+
+  /** Get the value of the dual variables associated to the constraints. */
+  virtual void getDualSolution(Ref_vectorX res);
+
+  /** Delete the solvers of all the problem sizes, releasing their memory. */
+  virtual void clearWarmStartData();
+
+  /** Get the maximum number of problem sizes for which a solver is kept. */
+  unsigned int getMaximumNumberOfProblems(){ return m_maxProblems; }
 
-  virtual void getDualSolution(Ref_vectorX res){ m_solver.getDualSolution(res.data()); }
+  /** Set the maximum number of problem sizes for which a solver is kept (at least 1, default 4).
+   * When a problem of a new size is solved and the limit is reached, the solver of the least
+   * recently used size is deleted, so it will be initialized again if that size is used later. */
+  void setMaximumNumberOfProblems(unsigned int maxProblems);
 
 };
 
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef ROBUST_EQUILIBRIUM_LIB_STANCE_LIBRARY_HH
+#define ROBUST_EQUILIBRIUM_LIB_STANCE_LIBRARY_HH
+
+#include <robust-equilibrium-lib/config.hh>
+#include <robust-equilibrium-lib/matrix_archive.hh>
+#include <robust-equilibrium-lib/static_equilibrium.hh>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace robust_equilibrium
+{
+
+/**
+ * @brief Library of precomputed contact states (stances), stored in a single MatrixArchive.
+ * A library is created by calling StaticEquilibrium::saveContactState for each stance with the
+ * same MatrixArchiveWriter. Opening the library maps the whole file in memory and only reads its index,
+ * while loading a stance into a StaticEquilibrium object copies just the data of that stance.
+ */
+class ROBUST_EQUILIBRIUM_DLLAPI StanceLibrary
+{
+public:
+  /** Map the specified library file in memory and list its stances. */
+  bool open(const std::string& filename);
+
+  /** Unmap the library file. */
+  void close();
+
+  /** Number of stances in the library. */
+  size_t size() const { return m_names.size(); }
+
+  /** Name of the i-th stance. */
+  const std::string& getStanceName(size_t i) const { return m_names[i]; }
+
+  /** Return true if the library contains a stance with the specified name. */
+  bool contains(const std::string& name) const { return m_index.find(name)!=m_index.end(); }
+
+  /** Load the specified stance into se (see StaticEquilibrium::loadContactState). */
+  bool loadStance(const std::string& name, StaticEquilibrium& se) const;
+
+  /** Load the i-th stance into se (see StaticEquilibrium::loadContactState). */
+  bool loadStance(size_t i, StaticEquilibrium& se) const { return se.loadContactState(m_archive, m_names[i]); }
+
+  const MatrixArchive& getArchive() const { return m_archive; }
+
+private:
+  MatrixArchive             m_archive;
+  std::vector<std::string>  m_names;  /// names of the stances, in the order in which they have been saved
+  std::map<std::string,int> m_index;
+};
+
+} // end namespace robust_equilibrium
+
+#endif //ROBUST_EQUILIBRIUM_LIB_STANCE_LIBRARY_HH
@@ -6,14 +6,20 @@
 #ifndef ROBUST_EQUILIBRIUM_LIB_STATIC_EQUILIBRIUM_H
 #define ROBUST_EQUILIBRIUM_LIB_STATIC_EQUILIBRIUM_H
 
+#include <vector>
+#include <mutex>
 #include <Eigen/Dense>
 #include <robust-equilibrium-lib/config.hh>
 #include <robust-equilibrium-lib/util.hh>
 #include <robust-equilibrium-lib/solver_LP_abstract.hh>
+#include <robust-equilibrium-lib/polytope_cache.hh>
 
 namespace robust_equilibrium
 {
 
+class MatrixArchive;
+class MatrixArchiveWriter;
+
 enum ROBUST_EQUILIBRIUM_DLLAPI StaticEquilibriumAlgorithm
 {
   STATIC_EQUILIBRIUM_ALGORITHM_LP,  /// primal LP formulation
@@ -24,20 +30,53 @@ enum ROBUST_EQUILIBRIUM_DLLAPI StaticEquilibriumAlgorithm
   STATIC_EQUILIBRIUM_ALGORITHM_DIP  /// incremental projection algorithm based on dual LP formulation
 };
 
+/**
+ * @brief Regular grid of com positions on which StaticEquilibrium::computeRobustnessMap computes
+ * the robustness. The com position of cell (i,j,k) is origin + (i*step(0), j*step(1), k*step(2)).
+ */
+struct ROBUST_EQUILIBRIUM_DLLAPI RobustnessGrid
+{
+  RobustnessGrid()
+    : origin(Vector3::Zero()), step(Vector3::Ones()), nx(0), ny(0), nz(1), tolerance(1e-6) {}
+
+  Vector3       origin;     /// com position of the cell (0,0,0)
+  Vector3       step;       /// distance between adjacent cells along x, y and z
+  unsigned int  nx, ny, nz; /// number of cells along x, y and z (nz=1 for a 2d grid)
+  double        tolerance;  /// tolerance of the interpolation of the robustness (negative values disable it)
+
+  /** Total number of cells. */
+  long size() const { return (long)nx*ny*nz; }
+
+  /** Index of cell (i,j,k) in the output of computeRobustnessMap (x is the fastest varying coordinate). */
+  long index(unsigned int i, unsigned int j, unsigned int k=0) const { return ((long)k*ny + j)*nx + i; }
+};
+
 class ROBUST_EQUILIBRIUM_DLLAPI StaticEquilibrium
 {
 private:
-  static bool m_is_cdd_initialized;   /// true if cdd lib has been initialized, false otherwise
+  static std::mutex m_cdd_mutex;      /// serializes the calls to cdd lib, which is not thread safe
 
   std::string                 m_name;         /// name of this object
   StaticEquilibriumAlgorithm  m_algorithm;    /// current algorithm used
   Solver_LP_abstract*         m_solver;       /// LP solver
+  Solver_LP_abstract*         m_direction_solver; /// LP solver used to find extremum com positions in given directions
   SolverLP                    m_solver_type;  /// type of LP solver
+  PolytopeCache*              m_polytope_cache; /// cache of the polytopes computed with the PP algorithm (not owned)
 
   unsigned int  m_generatorsPerContact; /// number of generators to approximate the friction cone per contact point
   double        m_mass;                 /// mass of the system
   Vector3       m_gravity;              /// gravity vector
 
+  /** Current contacts, as specified by setNewContacts, addContacts and removeContacts */
+  MatrixX3 m_contactPoints;
+  MatrixX3 m_contactNormals;
+  double   m_frictionCoefficient;   /// negative until setNewContacts is called
+
+  /** Generators of the friction cone in the contact frame (3 X generatorsPerContact),
+   * computed for the friction coefficient m_coneTemplateFriction */
+  Matrix3X m_coneTemplate;
+  double   m_coneTemplateFriction;
+
   /** Gravito-inertial wrench generators (6 X numberOfContacts*generatorsPerContact) */
   Matrix6X m_G_centr;
 
@@ -49,6 +88,10 @@ private:
   MatrixX3 m_HD;
   VectorX  m_Hd;
 
+  /** H times the sum of the generators, so that HD com + Hd <= H G 1 b0 defines the support polygon
+   * of the com positions in robust equilibrium with robustness proportional to b0 (PP only) */
+  VectorX  m_HG1;
+
   /** Matrix and vector mapping 2d com position to GIW */
   Matrix63 m_D;
   Vector6 m_d;
@@ -56,8 +99,89 @@ private:
   /** Coefficient used for converting the robustness measure in Newtons */
   double m_b0_to_emax_coefficient;
 
+  /** Data of a Linear Program of the form
+   *  minimize    c' x
+   *  subject to  Alb <= A x <= Aub
+   *              lb <= x <= ub
+   */
+  struct LP_data
+  {
+    VectorX   c;
+    VectorX   lb;
+    VectorX   ub;
+    MatrixXX  A;
+    VectorX   Alb;
+    VectorX   Aub;
+    VectorX   x;    /// solution
+    VectorX   y;    /// dual solution associated to the constraints
+  };
+
+  /** LP solved by computeEquilibriumRobustness. It is built in setNewContacts
+   * so that each query only needs to update the terms depending on the com position. */
+  LP_data m_robustness_lp;
+
+  /** LP used to find the extremum com position in a given direction (primal formulation
+   * for the LP, LP2 and IP algorithms, dual formulation for the DLP and DIP algorithms).
+   * It has its own solver, so that sweeping many directions can always warm start. It is built in setNewContacts
+   * so that each query only needs to update the terms depending on the direction. */
+  LP_data m_direction_lp;
+
+  /** LP solvers used by the worker threads of the batch version of computeEquilibriumRobustness.
+   * They are kept across calls so that each worker can warm start from its previous solution. */
+  std::vector<Solver_LP_abstract*> m_batch_solvers;
+
   bool computePolytopeProjection(Cref_matrix6X v);
 
+  /**
+   * @brief Compute the gravito-inertial wrench generators of the specified contacts.
+   * @param G_centr Output 6 X numberOfContacts*generatorsPerContact matrix of generators.
+   * @return False if a contact normal does not have norm 1.
+   */
+  bool computeContactGenerators(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals,
+                                double frictionCoefficient, Ref_matrix6X G_centr);
+
+  /** Compute from m_G_centr the data used by the current algorithm: the wrench cone and support polygon
+   * for PP, the support polygon for IP and DIP, the LPs for the other algorithms. */
+  bool setupAlgorithm();
+
+  /** Allocate m_robustness_lp and fill in all the terms that do not depend on the com position. */
+  void setupRobustnessLp();
+
+  /** Allocate m_direction_lp and fill in all the terms that do not depend on the direction. */
+  void setupDirectionLp();
+
+  /**
+   * @brief Find the extremum 2d com position in the specified 2d direction by solving m_direction_lp.
+   * @param a Horizontal direction in which to look for the extremum.
+   * @param b0 Minimum coefficient of the contact force generators.
+   * @param com Output horizontal com position.
+   * @return The status of the LP, in terms of the primal problem (i.e. LP_STATUS_INFEASIBLE
+   * if no com position is in equilibrium, LP_STATUS_UNBOUNDED if the equilibrium region
+   * is unbounded in the direction a).
+   */
+  LP_status solveDirectionLp(Cref_vector2 a, double b0, Ref_vector2 com);
+
+  /**
+   * @brief Compute the support polygon HD com + Hd <= 0 with the incremental projection algorithm,
+   * i.e. by expanding an inner approximation of the polygon with the extremum com positions
+   * found in the directions normal to its edges, until no edge can be pushed further.
+   * @return True if the operation succeeded, false otherwise.
+   */
+  bool computeIncrementalProjection();
+
+  /** Update the com-dependent terms of the specified robustness LP and solve it with the specified solver. */
+  LP_status solveRobustnessLp(Cref_vector3 com, Solver_LP_abstract* solver, LP_data &lp, double &robustness);
+
+  /**
+   * @brief Compute the robustness of the cells of row j of the first layer of the grid
+   * (see computeRobustnessMap), scanning them from the last one if reverse is true.
+   * @param robustness Output robustness of the nx cells of the row.
+   * @param status Output status of the nx cells of the row.
+   */
+  void computeRobustnessRow(const RobustnessGrid& grid, unsigned int j, bool reverse,
+                            Solver_LP_abstract* solver, LP_data &lp,
+                            value_type* robustness, LP_status* status);
+
   /**
    * @brief Given the smallest coefficient of the contact force generators it computes
    * the minimum norm of force error necessary to have a contact force on
@@ -83,6 +207,8 @@ public:
   StaticEquilibrium(std::string name, double mass, unsigned int generatorsPerContact,
                     SolverLP solver_type, bool useWarmStart=true);
 
+  ~StaticEquilibrium();
+
   /**
    * @brief Returns the useWarmStart flag.
    * @return True if the LP solver is allowed to use warm start, false otherwise.
@@ -93,7 +219,15 @@ public:
    * @brief Specifies whether the LP solver is allowed to use warm start.
    * @param uws True if the LP solver is allowed to use warm start, false otherwise.
    */
-  void useWarmStart(bool uws){ m_solver->setUseWarmStart(uws); }
+  void useWarmStart(bool uws);
+
+  /**
+   * @brief Release the data kept by the LP solvers to warm start the following problems.
+   * The qpOASES solvers keep the data of a bounded number of problem sizes (see
+   * Solver_LP_qpoases::setMaximumNumberOfProblems), which can be released with this method,
+   * e.g. after switching to a stance with a different number of contacts.
+   */
+  void clearWarmStartData();
 
   /**
    * @brief Get the name of this object.
@@ -103,6 +237,17 @@ public:
 
   StaticEquilibriumAlgorithm getAlgorithm(){ return m_algorithm; }
 
+  /**
+   * @brief Specify the cache of the polytopes computed by setNewContacts with the PP algorithm.
+   * When a cache is set, setNewContacts skips the polytope projection if the cache contains the
+   * result for the same contacts (up to the resolution of the cache).
+   * The cache can be shared among several objects and it must outlive them.
+   * @param cache The cache to use, or NULL to disable caching (default).
+   */
+  void setPolytopeCache(PolytopeCache* cache){ m_polytope_cache = cache; }
+
+  PolytopeCache* getPolytopeCache(){ return m_polytope_cache; }
+
   /**
    * @brief Specify a new set of contacts.
    * All 3d vectors are expressed in a reference frame having the z axis aligned with gravity.
@@ -112,10 +257,61 @@ public:
    * @param frictionCoefficient The contact friction coefficient.
    * @param alg Algorithm to use for testing equilibrium.
    * @return True if the operation succeeded, false otherwise.
+   * @note Different objects can call this method concurrently. With the PP algorithm, however,
+   * the double description computed by cdd lib is serialized, because cdd lib has global state.
+   * The IP and DIP algorithms do not use cdd lib, so they can run fully in parallel.
    */
   bool setNewContacts(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals,
                       double frictionCoefficient, StaticEquilibriumAlgorithm alg);
 
+  /**
+   * @brief Add contacts to the current ones, keeping the same friction coefficient and algorithm.
+   * Only the generators of the new contacts are computed. The data of the algorithm are computed again,
+   * except for the PP algorithm if the new stance is found in the polytope cache (see setPolytopeCache).
+   * @param contactPoints List of N 3d contact points as an Nx3 matrix.
+   * @param contactNormals List of N 3d contact normal directions as an Nx3 matrix.
+   * @return True if the operation succeeded, false otherwise.
+   * @note setNewContacts must have been called before.
+   */
+  bool addContacts(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals);
+
+  /**
+   * @brief Remove a range of the current contacts. The generators of the other contacts are not
+   * computed again, while the data of the algorithm are updated as in addContacts.
+   * @param firstContact Index of the first contact to remove (contacts are in the order in which they
+   * have been added).
+   * @param numberOfContacts Number of consecutive contacts to remove.
+   * @return True if the operation succeeded, false otherwise.
+   */
+  bool removeContacts(unsigned int firstContact, unsigned int numberOfContacts);
+
+  /** Number of current contacts. */
+  long getNumberOfContacts(){ return m_contactPoints.rows(); }
+
+  /**
+   * @brief Save the contact state computed by setNewContacts (generators, wrench cone, support polygon
+   * and robustness conversion coefficient) in an archive, so that it can be restored with loadContactState
+   * without computing it again. The state is stored as the matrices "name/info", "name/contactPoints",
+   * "name/contactNormals", "name/G_centr", "name/H", "name/h", "name/HD", "name/Hd" and "name/HG1".
+   * The wrench cone (H, h) is empty for the IP and DIP algorithms, and all the matrices of the
+   * projections (H, h, HD, Hd, HG1) are empty for the LP-based algorithms.
+   * @param writer Open archive writer.
+   * @param name Name of the contact state, which must be unique in the archive.
+   * @return True if the operation succeeded, false otherwise.
+   */
+  bool saveContactState(MatrixArchiveWriter& writer, const std::string& name);
+
+  /**
+   * @brief Restore a contact state saved with saveContactState, as if setNewContacts had been called
+   * with the same contacts and algorithm. The LPs used by the LP-based algorithms are set up again,
+   * but no polytope projection is computed.
+   * @param archive Open archive containing the contact state.
+   * @param name Name of the contact state.
+   * @return False if the archive does not contain a valid contact state with the specified name, or if it
+   * has been computed with a different mass or number of generators per contact.
+   */
+  bool loadContactState(const MatrixArchive& archive, const std::string& name);
+
   /**
    * @brief Compute a measure of the robustness of the equilibrium of the specified com position.
    * This amounts to solving the following LP:
@@ -136,9 +332,53 @@ public:
    * @note If the system is in force closure the status will be LP_STATUS_UNBOUNDED, meaning that the
    * system can reach infinite robustness. This is due to the fact that we are not considering
    * any upper limit for the friction cones.
+   * @note With the PP algorithm no LP is solved: the robustness is the signed distance of the
+   * gravito-inertial wrench D c + d from the boundary of the gravito-inertial wrench cone.
+   * This measure has the same sign as the LP-based ones, but a different scale.
    */
   LP_status computeEquilibriumRobustness(Cref_vector3 com, double &robustness);
 
+  /**
+   * @brief Compute the robustness of the equilibrium of a list of com positions.
+   * The com positions are split in contiguous blocks that are processed in parallel,
+   * each worker thread using its own LP solver.
+   * This method is available for the same algorithms as the single-com version.
+   * @param coms List of N 3d com positions to test as an Nx3 matrix.
+   * @param robustness Output N-dimensional vector of robustness measures.
+   * @param status Output list of N LP solver status, one for each com position.
+   * @param nThreads Number of worker threads to use, 0 means one per available core.
+   * @return True if the operation could be performed, false otherwise (e.g. wrong algorithm).
+   * The result of each com position is described by the corresponding entry of status.
+   */
+  bool computeEquilibriumRobustness(Cref_matrixX3 coms, Ref_vectorX robustness,
+                                    std::vector<LP_status> &status, unsigned int nThreads=0);
+
+  /**
+   * @brief Compute the robustness of the equilibrium of all the com positions of a 2d or 3d grid,
+   * exploiting the coherence of the grid:
+   *  - the robustness does not depend on the com height, so only the first layer of the grid is computed
+   *    and it is copied to the other ones;
+   *  - the rows of the layer (along x) are split in contiguous blocks that are processed in parallel,
+   *    each worker thread using its own LP solver;
+   *  - each worker scans its rows in serpentine order (alternating the direction of the rows), so that
+   *    each LP is warm started from the solution of a neighbouring cell;
+   *  - the robustness is a concave function of the com position, so if the robustness of three cells of
+   *    a row lies on a line it is linear between them: while this holds the scan skips an increasing number
+   *    of cells, whose robustness is interpolated from their neighbours.
+   * With the PP algorithm the robustness is computed for all the cells of the first layer at once,
+   * as in the batch version of computeEquilibriumRobustness.
+   * @param grid The grid of com positions. The robustness of three cells is considered linear if the
+   * middle one differs by less than grid.tolerance from the line through the other two; the error of
+   * the interpolated cells is then at most about twice the tolerance.
+   * @param robustness Output vector of grid.size() robustness measures, in the order given by grid.index,
+   * so that it can be used directly as a contiguous x-major buffer (e.g. an Eigen::Map on an external buffer).
+   * @param status Output list of grid.size() LP solver status (LP_STATUS_OPTIMAL for the interpolated cells).
+   * @param nThreads Number of worker threads to use, 0 means one per available core.
+   * @return True if the operation could be performed, false otherwise (e.g. wrong algorithm).
+   */
+  bool computeRobustnessMap(const RobustnessGrid& grid, Ref_vectorX robustness,
+                            std::vector<LP_status> &status, unsigned int nThreads=0);
+
   /**
    * @brief Check whether the specified com position is in robust equilibrium.
    * This amounts to solving the following feasibility LP:
@@ -157,9 +397,23 @@ public:
    * @param equilibrium True if com is in robust equilibrium, false otherwise.
    * @param e_max Desired robustness level.
    * @return The status of the LP solver.
+   * @note This method uses the support polygon computed in setNewContacts, so no LP is actually solved.
+   * A nonzero e_max is supported only by the PP algorithm, for which the robust support polygon
+   * differs from the nominal one only in its offset vector.
    */
   LP_status checkRobustEquilibrium(Cref_vector3 com, bool &equilibrium, double e_max=0.0);
 
+  /**
+   * @brief Check whether the specified com positions are in robust equilibrium.
+   * This is the batch version of the method above, which processes blocks of com positions
+   * at once, testing each face of the support polygon on all the positions of the block.
+   * @param coms List of N 3d com positions to test as an Nx3 matrix.
+   * @param equilibrium Output list of N flags, true if the corresponding com is in robust equilibrium.
+   * @param e_max Desired robustness level.
+   * @return The status of the LP solver.
+   */
+  LP_status checkRobustEquilibrium(Cref_matrixX3 coms, std::vector<bool> &equilibrium, double e_max=0.0);
+
   /**
    * @brief Compute the extremum CoM position over the line a*x + a0 that is in robust equilibrium.
    * This amounts to solving the following LP:
@@ -200,7 +454,8 @@ public:
    *     D         is the 6x3 matrix mapping the CoM position in gravito-inertial wrench
    *     d         is the 6d vector containing the gravity part of the gravito-inertial wrench
    * @param direction Desired 3d direction.
-   * @param com Output 3d com position.
+   * @param com Output 3d com position. Since the equilibrium region does not depend on the com height,
+   * its z coordinate is set to zero, and any direction with a nonzero z component is unbounded.
    * @param e_max Desired robustness level.
    * @return The status of the LP solver.
    * @note If the system is in force closure the status will be LP_STATUS_UNBOUNDED, meaning that the
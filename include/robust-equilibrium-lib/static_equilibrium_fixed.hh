@@ -0,0 +1,211 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef ROBUST_EQUILIBRIUM_LIB_STATIC_EQUILIBRIUM_FIXED_HH
+#define ROBUST_EQUILIBRIUM_LIB_STATIC_EQUILIBRIUM_FIXED_HH
+
+#include <string>
+#include <cmath>
+#include <Eigen/Dense>
+#include <robust-equilibrium-lib/config.hh>
+#include <robust-equilibrium-lib/util.hh>
+#include <robust-equilibrium-lib/logger.hh>
+#include <robust-equilibrium-lib/solver_LP_abstract.hh>
+
+namespace robust_equilibrium
+{
+
+/**
+ * @brief Version of StaticEquilibrium with a number of generators per contact and a maximum
+ * number of contacts known at compile time, e.g. StaticEquilibriumFixed<4,8> for two feet
+ * with 4 contact points each, approximating the friction cones with 4 generators.
+ * The generators and the LP data are stored in Eigen matrices with fixed maximum sizes, so that
+ * setNewContacts and computeEquilibriumRobustness never allocate memory (except inside the LP solver),
+ * and the generators of each contact are computed with fixed-size (unrolled) kernels.
+ * Only the dual LP formulation (STATIC_EQUILIBRIUM_ALGORITHM_DLP) is supported, which has the
+ * smallest number of variables; it gives the same results as StaticEquilibrium with that algorithm.
+ */
+template<int NumGenerators, int MaxContacts>
+class StaticEquilibriumFixed
+{
+public:
+  static_assert(NumGenerators>=3, "Algorithm cannot work with less than 3 generators per contact");
+  static_assert(MaxContacts>=1, "At least one contact is necessary");
+
+  enum { MaxGenerators = NumGenerators*MaxContacts };
+
+  /** Generators of the friction cone in the contact frame */
+  typedef Eigen::Matrix<value_type, 3, NumGenerators, Eigen::RowMajor>                          ConeTemplate;
+  /** Gravito-inertial wrench generators, with at most MaxGenerators columns */
+  typedef Eigen::Matrix<value_type, 6, Eigen::Dynamic, Eigen::RowMajor, 6, MaxGenerators>       Matrix6G;
+  /** Constraint matrix of the dual LP, with at most MaxGenerators+1 rows */
+  typedef Eigen::Matrix<value_type, Eigen::Dynamic, 6, Eigen::RowMajor, MaxGenerators+1, 6>     MatrixG6;
+  typedef Eigen::Matrix<value_type, Eigen::Dynamic, 1, Eigen::ColMajor, MaxGenerators+1, 1>     VectorG;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @brief StaticEquilibriumFixed constructor.
+   * @param name Name of the object.
+   * @param mass Mass of the system for which to test equilibrium.
+   * @param solver_type Type of LP solver to use.
+   * @param useWarmStart Whether the LP solver can warm start the resolution.
+   */
+  StaticEquilibriumFixed(const std::string& name, double mass, SolverLP solver_type, bool useWarmStart=true)
+    : m_name(name), m_mass(mass), m_frictionCoefficient(-1.0), m_b0_to_emax_coefficient(0.0)
+  {
+    m_solver = Solver_LP_abstract::getNewSolver(solver_type);
+    m_solver->setUseWarmStart(useWarmStart);
+
+    Vector3 gravity(0.0, 0.0, -9.81);
+    m_d.setZero();
+    m_d.template head<3>() = m_mass*gravity;
+    m_D.setZero();
+    m_D.template block<3,3>(3,0) = crossMatrix(-m_mass*gravity);
+
+    m_lp_lb = -Vector6::Ones()*1e100;
+    m_lp_ub = Vector6::Ones()*1e100;
+  }
+
+  ~StaticEquilibriumFixed()
+  {
+    delete m_solver;
+  }
+
+  std::string getName(){ return m_name; }
+
+  /** Number of current contacts. */
+  long getNumberOfContacts(){ return m_G_centr.cols()/NumGenerators; }
+
+  /** Gravito-inertial wrench generators (6 X numberOfContacts*NumGenerators). */
+  const Matrix6G& getGeneratorMatrix(){ return m_G_centr; }
+
+  /**
+   * @brief Specify a new set of contacts (see StaticEquilibrium::setNewContacts).
+   * @param contactPoints List of N 3d contact points as an Nx3 matrix, with N <= MaxContacts.
+   * @param contactNormals List of N 3d contact normal directions as an Nx3 matrix.
+   * @param frictionCoefficient The contact friction coefficient.
+   * @return True if the operation succeeded, false otherwise.
+   */
+  bool setNewContacts(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals, double frictionCoefficient)
+  {
+    assert(contactPoints.rows()==contactNormals.rows());
+    const long c = contactPoints.rows();
+    if(c>MaxContacts)
+    {
+      SEND_ERROR_MSG(m_name+" supports at most "+toString(MaxContacts)+" contacts, while "+toString(c)+" were specified");
+      return false;
+    }
+    for(long i=0; i<c; i++)
+    {
+      if(fabs(contactNormals.row(i).norm()-1.0)>1e-6)
+      {
+        SEND_ERROR_MSG("Contact normals should have norm 1, this has norm "+toString(contactNormals.row(i).norm()));
+        return false;
+      }
+    }
+
+    if(frictionCoefficient!=m_frictionCoefficient)
+    {
+      // see StaticEquilibrium::computeContactGenerators
+      const double delta_theta = 2*M_PI/NumGenerators;
+      const double norm = sqrt(1.0 + frictionCoefficient*frictionCoefficient);
+      for(int j=0; j<NumGenerators; j++)
+      {
+        m_coneTemplate(0,j) = frictionCoefficient*sin(j*delta_theta)/norm;
+        m_coneTemplate(1,j) = frictionCoefficient*cos(j*delta_theta)/norm;
+        m_coneTemplate(2,j) = 1.0/norm;
+      }
+      // the distance between the friction cone boundaries and the sum of the generators does not
+      // depend on the orientation of the contact (see StaticEquilibrium::setNewContacts)
+      Vector3 f0 = m_coneTemplate.rowwise().sum();
+      Vector3 g0 = m_coneTemplate.col(0);
+      m_b0_to_emax_coefficient = (f0.cross(g0)).norm();
+      m_frictionCoefficient = frictionCoefficient;
+    }
+
+    m_G_centr.resize(6, c*NumGenerators);
+    Vector3 T1, T2;
+    Matrix3 R;
+    for(long i=0; i<c; i++)
+    {
+      T1 = contactNormals.row(i).cross(Vector3::UnitY());
+      if(T1.norm()<1e-5)
+        T1 = contactNormals.row(i).cross(Vector3::UnitX());
+      T2 = contactNormals.row(i).transpose().cross(T1);
+      R.col(0) = T1.normalized();
+      R.col(1) = T2.normalized();
+      R.col(2) = contactNormals.row(i).transpose();
+
+      const long k = i*NumGenerators;
+      m_G_centr.template block<3,NumGenerators>(0,k).noalias() = -R * m_coneTemplate;
+      const value_type px = contactPoints(i,0), py = contactPoints(i,1), pz = contactPoints(i,2);
+      m_G_centr.template block<1,NumGenerators>(3,k) = py*m_G_centr.template block<1,NumGenerators>(2,k)
+                                                     - pz*m_G_centr.template block<1,NumGenerators>(1,k);
+      m_G_centr.template block<1,NumGenerators>(4,k) = pz*m_G_centr.template block<1,NumGenerators>(0,k)
+                                                     - px*m_G_centr.template block<1,NumGenerators>(2,k);
+      m_G_centr.template block<1,NumGenerators>(5,k) = px*m_G_centr.template block<1,NumGenerators>(1,k)
+                                                     - py*m_G_centr.template block<1,NumGenerators>(0,k);
+    }
+
+    // see StaticEquilibrium::computeEquilibriumRobustness for the dual LP formulation
+    const long m = m_G_centr.cols();
+    m_lp_A.resize(m+1, 6);
+    m_lp_A.topRows(m) = m_G_centr.transpose();
+    m_lp_A.row(m) = m_G_centr.rowwise().sum().transpose();
+    m_lp_Alb.setZero(m+1);
+    m_lp_Alb(m) = 1.0;
+    m_lp_Aub.setConstant(m+1, 1e100);
+    m_lp_Aub(m) = 1.0;
+    return true;
+  }
+
+  /**
+   * @brief Compute the robustness of the equilibrium of the specified com position
+   * (see StaticEquilibrium::computeEquilibriumRobustness).
+   * @param com The 3d center of mass position to test.
+   * @param robustness The computed measure of robustness.
+   * @return The status of the LP solver.
+   */
+  LP_status computeEquilibriumRobustness(Cref_vector3 com, double &robustness)
+  {
+    m_lp_c = m_D*com + m_d;
+    LP_status status = m_solver->solve(m_lp_c, m_lp_lb, m_lp_ub, m_lp_A, m_lp_Alb, m_lp_Aub, m_lp_x);
+    if(status==LP_STATUS_OPTIMAL)
+    {
+      robustness = m_solver->getObjectiveValue()*m_b0_to_emax_coefficient;
+      return status;
+    }
+    SEND_DEBUG_MSG("Dual LP problem for com position "+toString(com.transpose())+" could not be solved: "+toString(status));
+
+    // switch UNFEASIBLE and UNBOUNDED flags because we are solving dual problem
+    if(status==LP_STATUS_INFEASIBLE)
+      status = LP_STATUS_UNBOUNDED;
+    else if(status==LP_STATUS_UNBOUNDED)
+      status = LP_STATUS_INFEASIBLE;
+    return status;
+  }
+
+private:
+  std::string         m_name;
+  Solver_LP_abstract* m_solver;
+  double              m_mass;
+  double              m_frictionCoefficient;      /// friction coefficient used to compute m_coneTemplate
+  double              m_b0_to_emax_coefficient;
+
+  ConeTemplate        m_coneTemplate;
+  Matrix6G            m_G_centr;
+  Matrix63            m_D;
+  Vector6             m_d;
+
+  /** Data of the dual LP */
+  Vector6             m_lp_c, m_lp_lb, m_lp_ub, m_lp_x;
+  MatrixG6            m_lp_A;
+  VectorG             m_lp_Alb, m_lp_Aub;
+};
+
+} // end namespace robust_equilibrium
+
+#endif //ROBUST_EQUILIBRIUM_LIB_STATIC_EQUILIBRIUM_FIXED_HH
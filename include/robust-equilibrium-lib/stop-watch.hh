@@ -29,6 +29,12 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define WBR_STOPWATCH_H
 
 #include "robust-equilibrium-lib/Stdafx.hh"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
 
 #ifndef WIN32
 	/* The classes below are exported */
@@ -48,8 +54,72 @@ enum StopwatchMode
 {
   NONE	    = 0,  // Clock is not initialized
   CPU_TIME  = 1,  // Clock calculates time ranges using ctime and CLOCKS_PER_SEC
-  REAL_TIME = 2   // Clock calculates time by asking the operating system how
-                  // much real time passed
+  REAL_TIME = 2   // Clock calculates time using std::chrono::steady_clock
+};
+
+/** 
+    @brief Log-linear histogram of durations, used to compute percentiles.
+
+    Durations are recorded in nanoseconds. Each power of two is split into
+    SUB_BUCKETS linear buckets, so the relative error of a percentile is
+    at most 1/SUB_BUCKETS, whatever the magnitude of the durations.
+    The counters are atomic, so record() never blocks and can be called
+    concurrently from different threads.
+*/
+class LatencyHistogram {
+public:
+  static const unsigned int SUB_BUCKET_BITS = 4;
+  static const unsigned int SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+  static const unsigned int N_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  LatencyHistogram() { reset(); }
+  LatencyHistogram(const LatencyHistogram& other) { *this = other; }
+  LatencyHistogram& operator=(const LatencyHistogram& other);
+
+  /** Add a duration expressed in seconds */
+  inline void record(long double seconds)
+  { record_ns(seconds<=0 ? 0 : (uint64_t)(seconds*1e9L)); }
+
+  /** Add a duration expressed in nanoseconds */
+  inline void record_ns(uint64_t ns)
+  { counts[get_bucket(ns)].fetch_add(1, std::memory_order_relaxed); }
+
+  /** Add the durations recorded by other to this */
+  void merge(const LatencyHistogram& other);
+
+  /** Remove all the recorded durations */
+  void reset();
+
+  /** Number of recorded durations */
+  uint64_t get_count() const;
+
+  /** Number of durations recorded in the specified bucket */
+  uint64_t get_bucket_count(unsigned int bucket) const
+  { return counts[bucket].load(std::memory_order_relaxed); }
+
+  /** Return the duration in seconds below which lies the specified percentage
+      (in [0, 100]) of the recorded durations, or 0 if the histogram is empty. */
+  long double get_percentile(double percentage) const;
+
+  /** Index of the bucket containing the specified duration in nanoseconds */
+  static inline unsigned int get_bucket(uint64_t ns)
+  {
+    if(ns < SUB_BUCKETS)
+      return (unsigned int)ns;
+    unsigned int e = 63;                  // index of the most significant bit
+    while(!(ns >> e)) e--;
+    unsigned int shift = e - SUB_BUCKET_BITS;
+    return (shift+1)*SUB_BUCKETS + (unsigned int)((ns >> shift) & (SUB_BUCKETS-1));
+  }
+
+  /** Smallest duration in nanoseconds contained in the specified bucket */
+  static uint64_t get_bucket_lower_bound(unsigned int bucket);
+
+  /** Largest duration in nanoseconds contained in the specified bucket */
+  static uint64_t get_bucket_upper_bound(unsigned int bucket);
+
+private:
+  std::atomic<uint64_t> counts[N_BUCKETS];
 };
 
 /** 
@@ -142,16 +212,46 @@ enum StopwatchMode
     Same as above, you can redirect the output by providing a std::ostream&
     parameter.
 
+    Performances started while another one is running are recorded as its
+    children, so report_all() prints the measurements as a tree, in which
+    the same ID can appear under different parents. The report()/get_*()
+    methods aggregate all the occurrences of an ID.
+
+    Each thread records its measurements in its own buffer, and the buffers
+    are merged by the reporting methods, so different threads can profile
+    concurrently. In time-critical code the string lookup can be avoided
+    by interning the ID once, which the PROFILE_* macros do automatically
+    with a static variable per call site:
+
+    @code
+    {
+      PROFILE_SCOPE("My astounding algorithm"); // stopped at end of scope
+      PROFILE_START("Main loop");
+      // Loop
+      PROFILE_STOP("Main loop");
+    }
+    @endcode
+
 */
 class Stopwatch {
 public:
-	
+
+  /** Interned identifier of a performance name */
+  typedef unsigned int ScopeId;
+
   /** Constructor */
   Stopwatch(StopwatchMode _mode=NONE);
   
   /** Destructor */
   ~Stopwatch();
   
+  /** Return the ID associated to the specified performance name, creating
+      it if needed. The same name always gets the same ID. */
+  static ScopeId get_scope_id(const std::string& perf_name);
+
+  /** Return the performance name associated to the specified ID */
+  static std::string get_scope_name(ScopeId id);
+
   /** Tells if a performance with a certain ID exists */
   bool performance_exists(std::string perf_name);
   
@@ -160,12 +260,15 @@ public:
   
   /** Start the stopwatch related to a certain piece of code */
   void start(std::string perf_name);
+  void start(ScopeId id);
   
   /** Stops the stopwatch related to a certain piece of code */
   void stop(std::string perf_name);
+  void stop(ScopeId id);
   
   /** Stops the stopwatch related to a certain piece of code */
   void pause(std::string perf_name);
+  void pause(ScopeId id);
   
   /** Reset a certain performance record */
   void reset(std::string perf_name);
@@ -179,6 +282,15 @@ public:
   
   /** Dump the data of all the performance records */
   void report_all(int precision=2, std::ostream& output = std::cout);
+
+  /** Dump the data of all the performance records in CSV format, one line per
+      record. Records are identified by their path in the tree of nested
+      performances (e.g. "parent/child"), and times are in ms. */
+  void report_all_csv(std::ostream& output = std::cout);
+
+  /** Dump the data of all the performance records in JSON format, including
+      the non-empty buckets of the histograms (upper bound in ns, count). */
+  void report_all_json(std::ostream& output = std::cout);
   
   /** Returns total execution time of a certain performance */
   long double get_total_time(std::string perf_name);
@@ -194,9 +306,13 @@ public:
   
   /** Return last measurement of a certain performance */
   long double get_last_time(std::string perf_name);
+
+  /** Returns the time below which lies the specified percentage (in [0, 100])
+      of the measurements of a certain performance */
+  long double get_percentile(std::string perf_name, double percentage);
   
   /** Return the time since the start of the last measurement of a given
-      performance. */
+      performance (started by the calling thread). */
   long double get_time_so_far(std::string perf_name);
   
   /**	Turn off clock, all the Stopwatch::* methods return without doing
@@ -220,7 +336,7 @@ protected:
       min_time(0),
       max_time(0),
       last_time(0),
-      paused(false),
+      paused_time(0),
       stops(0) {
     }
     
@@ -239,25 +355,123 @@ protected:
     /** Last time */
     long double last_time;
     
-    /** Tells if this performance has been paused, only for internal use */
-    bool paused;
+    /** Time accumulated by pause() since the last stop(), only for internal use */
+    long double paused_time;
     
     /** How many cycles have been this stopwatch executed? */
     int	stops;
+
+    /** Distribution of the measured times */
+    LatencyHistogram histogram;
+
+    /** Add the measurements of other to this */
+    void merge(const PerformanceData& other);
+
+    /** Percentile of the measured times, clamped to [min_time, max_time] */
+    long double get_percentile(double percentage) const;
   };
-  
+
+  /** Node of the tree of nested performances */
+  struct ScopeNode {
+    ScopeNode(ScopeId scope, int parent) : scope(scope), parent(parent) {}
+    ScopeId           scope;      /// ID of the performance
+    int               parent;     /// index of the parent node, -1 for the root
+    std::vector<int>  children;   /// indexes of the children nodes
+    PerformanceData   data;
+  };
+
+  /** Measurements of a single thread. The mutex is only contended while reporting. */
+  struct ThreadData {
+    ThreadData();
+    std::mutex              mutex;
+    std::vector<ScopeNode>  nodes;      /// tree of performances, nodes[0] is the root
+    std::vector<int>        stack;      /// nodes currently running, innermost last
+    bool                    finished;   /// true when the thread has exited
+
+    /** Return the index of the child of node parent with the specified ID, adding it if needed */
+    int get_child(int parent, ScopeId scope);
+
+    /** Add the tree of other (starting from its node src) to the subtree of node dst */
+    void merge(const ThreadData& other, int dst=0, int src=0);
+  };
+
+  /** Return the buffer of the calling thread, creating it at the first call */
+  ThreadData& thread_data();
+
+  /** Merge the buffers of all the threads into result */
+  void collect(ThreadData& result);
+
+  /** Merge all the occurrences of a performance in the buffers of all the threads.
+      Throw an exception if the performance does not exist. */
+  PerformanceData get_data(const std::string& perf_name);
+
+  /** Print one line of the report */
+  void report(const std::string& name, const PerformanceData& perf_info,
+              int precision, std::ostream& output);
+
+  /** A performance record with its position in the tree of nested performances */
+  struct Record {
+    std::string     name;   /// name of the performance
+    std::string     path;   /// names of the ancestors and of the performance, separated by '/'
+    int             depth;  /// number of ancestors
+    PerformanceData data;
+  };
+
+  /** Return all the performance records, merged over all the threads, in depth-first order */
+  void get_all_records(std::vector<Record>& records);
+
   /** Flag to hold the clock's status */
-  bool active;
+  std::atomic<bool> active;
 
   /** Time taking mode */
   StopwatchMode mode;
   
-  /** Pointer to the dynamic structure which holds the collection of performance
-      data */
-  std::map<std::string, PerformanceData >* records_of;
+  /** Unique identifier of this stopwatch, used to find the buffers of the threads */
+  unsigned long long instance_id;
+
+  /** Buffers of the threads that used this stopwatch */
+  std::vector<std::shared_ptr<ThreadData> > threads;
+
+  /** Measurements of the threads that have exited */
+  ThreadData finished_threads;
+
+  /** Protect threads and finished_threads */
+  std::mutex threads_mutex;
   
 };
 
+/** Start a performance when constructed and stop it when destroyed */
+class StopwatchScope {
+public:
+  StopwatchScope(Stopwatch& s, Stopwatch::ScopeId id) : s(s), id(id) { s.start(id); }
+  ~StopwatchScope() { s.stop(id); }
+private:
+  Stopwatch& s;
+  Stopwatch::ScopeId id;
+};
+
+#define STOPWATCH_CONCAT_IMPL(a,b) a##b
+#define STOPWATCH_CONCAT(a,b) STOPWATCH_CONCAT_IMPL(a,b)
+
+/** Profile the rest of the current scope with getProfiler() */
+#define PROFILE_SCOPE(perf_name)                                                        \
+  static const Stopwatch::ScopeId STOPWATCH_CONCAT(_stopwatch_id_,__LINE__) =           \
+    Stopwatch::get_scope_id(perf_name);                                                 \
+  StopwatchScope STOPWATCH_CONCAT(_stopwatch_scope_,__LINE__)(getProfiler(),            \
+    STOPWATCH_CONCAT(_stopwatch_id_,__LINE__))
+
+/** Start/stop a performance of getProfiler() without looking up its name at every call */
+#define PROFILE_START(perf_name)                                                        \
+  do {                                                                                  \
+    static const Stopwatch::ScopeId _stopwatch_id = Stopwatch::get_scope_id(perf_name); \
+    getProfiler().start(_stopwatch_id);                                                 \
+  } while(0)
+#define PROFILE_STOP(perf_name)                                                         \
+  do {                                                                                  \
+    static const Stopwatch::ScopeId _stopwatch_id = Stopwatch::get_scope_id(perf_name); \
+    getProfiler().stop(_stopwatch_id);                                                  \
+  } while(0)
+
 Stopwatch& getProfiler();
 
 #ifndef WIN32
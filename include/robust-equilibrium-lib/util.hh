@@ -19,7 +19,10 @@
 namespace robust_equilibrium
 {
 
-  //#define USE_FLOAT 1;
+  /** Scalar type of all the vectors and matrices of the library. Defining USE_FLOAT (CMake option USE_FLOAT)
+   * switches it to single precision, which halves the memory traffic of the generator construction and
+   * of the half-space tests of the PP algorithm. The LP solvers and cdd lib only support double precision,
+   * so the data are converted at their interfaces, and files are always written in double precision. */
 #ifdef USE_FLOAT
   typedef float value_type;
 #else
@@ -63,8 +66,34 @@ namespace robust_equilibrium
   typedef const Eigen::Ref<const Matrix6X>    & Cref_matrix6X;
   typedef const Eigen::Ref<const MatrixXX>    & Cref_matrixXX;
 
+  /** Double precision types, used at the interface with the LP solvers and in files */
+  typedef Eigen::Matrix <double, Eigen::Dynamic, 1>                                   VectorX_d;
+  typedef Eigen::Matrix <double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>     MatrixXX_d;
+
+  /**
+   * Return a pointer to the data of v in double precision: the data of v itself if value_type is double,
+   * otherwise the data of buffer, which is set to a copy of v converted to double.
+   */
+#ifdef USE_FLOAT
+  inline const double* doubleData(Cref_vectorX v, VectorX_d& buffer)
+  {
+    buffer = v.cast<double>();
+    return buffer.data();
+  }
+
+  inline const double* doubleData(Cref_matrixXX m, MatrixXX_d& buffer)
+  {
+    buffer = m.cast<double>();
+    return buffer.data();
+  }
+#else
+  inline const double* doubleData(Cref_vectorX v, VectorX_d&){ return v.data(); }
+  inline const double* doubleData(Cref_matrixXX m, MatrixXX_d&){ return m.data(); }
+#endif
+
   /**
    * Write the specified matrix to a binary file with the specified name.
+   * The values are always written in double precision.
    */
   template<class Matrix>
   bool writeMatrixToFile(const std::string &filename, const Matrix& matrix)
@@ -72,16 +101,19 @@ namespace robust_equilibrium
     std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
     if(!out.is_open())
       return false;
+    typedef Eigen::Matrix<double, Matrix::RowsAtCompileTime, Matrix::ColsAtCompileTime,
+                          Matrix::IsRowMajor ? Eigen::RowMajor : Eigen::ColMajor> MatrixDouble;
+    MatrixDouble values = matrix.template cast<double>();
     typename Matrix::Index rows=matrix.rows(), cols=matrix.cols();
     out.write((char*) (&rows), sizeof(typename Matrix::Index));
     out.write((char*) (&cols), sizeof(typename Matrix::Index));
-    out.write((char*) matrix.data(), rows*cols*sizeof(typename Matrix::Scalar) );
+    out.write((char*) values.data(), rows*cols*sizeof(double) );
     out.close();
     return true;
   }
 
   /**
-   * Read a matrix from the specified input binary file.
+   * Read a matrix from the specified input binary file, which contains double precision values.
    */
   template<class Matrix>
   bool readMatrixFromFile(const std::string &filename, Matrix& matrix)
@@ -89,12 +121,15 @@ namespace robust_equilibrium
     std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
     if(!in.is_open())
       return false;
+    typedef Eigen::Matrix<double, Matrix::RowsAtCompileTime, Matrix::ColsAtCompileTime,
+                          Matrix::IsRowMajor ? Eigen::RowMajor : Eigen::ColMajor> MatrixDouble;
     typename Matrix::Index rows=0, cols=0;
     in.read((char*) (&rows),sizeof(typename Matrix::Index));
     in.read((char*) (&cols),sizeof(typename Matrix::Index));
-    matrix.resize(rows, cols);
-    in.read( (char *) matrix.data() , rows*cols*sizeof(typename Matrix::Scalar) );
+    MatrixDouble values(rows, cols);
+    in.read( (char *) values.data() , rows*cols*sizeof(double) );
     in.close();
+    matrix = values.template cast<typename Matrix::Scalar>();
     return true;
   }
 
@@ -112,6 +147,10 @@ namespace robust_equilibrium
   Rotation crossMatrix(Cref_vector3 x);
 
 
+  /**
+   * Initialize the global constants of cdd lib. This can be called any number of times,
+   * from any thread: only the first call has an effect.
+   */
   void init_cdd_library();
 
   void release_cdd_library();
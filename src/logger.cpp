@@ -10,9 +10,9 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <iomanip>      // std::setprecision
-#include <boost/algorithm/string.hpp>
 #include <robust-equilibrium-lib/logger.hh>
 
 namespace robust_equilibrium
@@ -26,7 +26,8 @@ namespace robust_equilibrium
   }
 
   Logger::Logger(double timeSample, double streamPrintPeriod)
-    : m_timeSample(timeSample),
+    : m_lv(VERBOSITY_ALL),
+      m_timeSample(timeSample),
       m_streamPrintPeriod(streamPrintPeriod),
       m_printCountdown(0.0)
   {
@@ -51,40 +52,37 @@ namespace robust_equilibrium
     m_printCountdown -= m_timeSample;
   }
 
-  void Logger::sendMsg(string msg, MsgType type, const char* file, int line)
+  unsigned int Logger::getNewMsgId()
   {
-//    if(m_lv==VERBOSITY_NONE ||
-//       (m_lv==VERBOSITY_ERROR && !isErrorMsg(type)) ||
-//       (m_lv==VERBOSITY_WARNING_ERROR && !(isWarningMsg(type) || isErrorMsg(type))) ||
-//       (m_lv==VERBOSITY_INFO_WARNING_ERROR && isDebugMsg(type)))
-//      return;
+    static std::atomic<unsigned int> counter(0);
+    return counter++;
+  }
+
+  void Logger::sendMsg(const string& msg, MsgType type, unsigned int id, const char* file, int line)
+  {
+    if(!isEnabled(type))
+      return;
 
-    // if print is allowed by current verbosity level
     if(isStreamMsg(type))
     {
-      // check whether counter already exists
-      string id = file+toString(line);
-      map<string,double>::iterator it = m_stream_msg_counters.find(id);
-      if(it == m_stream_msg_counters.end())
-      {
-        // if counter doesn't exist then add one
-        m_stream_msg_counters.insert(make_pair(id, 0.0));
-        it = m_stream_msg_counters.find(id);
-      }
+      std::lock_guard<std::mutex> lock(m_stream_msg_mutex);
+      // if counter doesn't exist then add one
+      if(id >= m_stream_msg_counters.size())
+        m_stream_msg_counters.resize(id+1, 0.0);
+      double &counter = m_stream_msg_counters[id];
 
       // if counter is greater than 0 then decrement it and do not print
-      if(it->second>0.0)
+      if(counter>0.0)
       {
-        it->second -= m_timeSample;
+        counter -= m_timeSample;
         return;
       }
       else  // otherwise reset counter and print
-        it->second = m_streamPrintPeriod;
+        counter = m_streamPrintPeriod;
     }
 
-    vector<string> fields;
-    boost::split(fields, file, boost::is_any_of("/"));
-    const char* file_name = fields[fields.size()-1].c_str();
+    const char* file_name = strrchr(file, '/');
+    file_name = (file_name==NULL) ? file : file_name+1;
 
     if(isErrorMsg(type))
       printf("[ERROR %s %d] %s\n", file_name, line, msg.c_str());
@@ -114,5 +112,15 @@ namespace robust_equilibrium
     return true;
   }
 
+  void Logger::setVerbosity(LoggerVerbosity lv)
+  {
+    m_lv = lv;
+  }
+
+  LoggerVerbosity Logger::getVerbosity() const
+  {
+    return m_lv;
+  }
+
 } // namespace robust_equilibrium
 
@@ -0,0 +1,255 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#include <robust-equilibrium-lib/lp_capture.hh>
+#include <robust-equilibrium-lib/logger.hh>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+namespace robust_equilibrium
+{
+
+namespace
+{
+  const uint32_t RECORD_MAGIC = 0x5243504c; // "LPCR" in little endian
+
+  /** Header of each record of a capture file */
+  struct RecordHeader
+  {
+    uint32_t  magic;
+    uint32_t  size;       /// size of the whole record, header included [bytes]
+    int32_t   status;
+    int32_t   reserved;
+    double    solveTime;
+    int64_t   n;          /// number of variables
+    int64_t   m;          /// number of constraints
+  };
+
+  size_t recordSize(int64_t n, int64_t m)
+  {
+    return sizeof(RecordHeader) + sizeof(double)*(4*n + 2*m + n*m);
+  }
+
+  /** Read n double precision values from f into data, returning the number of values read. */
+  size_t readValues(FILE* f, value_type* data, size_t n)
+  {
+#ifdef USE_FLOAT
+    vector<double> values(n);
+    size_t read = fread(values.data(), sizeof(double), n, f);
+    for(size_t i=0; i<read; i++)
+      data[i] = (value_type) values[i];
+    return read;
+#else
+    return fread(data, sizeof(double), n, f);
+#endif
+  }
+}
+
+LpCapture::LpCapture(const string& filename, const LpCaptureOptions& options)
+  : m_options(options),
+    m_file(NULL),
+    m_readPos(0),
+    m_used(0),
+    m_stop(false),
+    m_solves(0),
+    m_captured(0),
+    m_dropped(0)
+{
+  m_file = fopen(filename.c_str(), "ab");
+  if(m_file==NULL)
+  {
+    SEND_ERROR_MSG("Impossible to open LP capture file "+filename);
+    return;
+  }
+  m_buffer.resize(m_options.bufferSize);
+  m_writer = thread(&LpCapture::writerLoop, this);
+}
+
+LpCapture::~LpCapture()
+{
+  if(m_file==NULL)
+    return;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_dataReady.notify_one();
+  m_writer.join();
+  fclose(m_file);
+}
+
+bool LpCapture::shouldCapture(double solveTime, LP_status status)
+{
+  unsigned long solve = m_solves++;
+  if(m_options.captureFailed && status!=LP_STATUS_OPTIMAL)
+    return true;
+  if(m_options.slowThreshold>0.0 && solveTime>m_options.slowThreshold)
+    return true;
+  if(m_options.samplingPeriod>0 && solve%m_options.samplingPeriod==0)
+    return true;
+  return false;
+}
+
+size_t LpCapture::copyToBuffer(size_t pos, const void* data, size_t size)
+{
+  const char* src = (const char*) data;
+  size_t first = min(size, m_buffer.size()-pos);
+  memcpy(&m_buffer[pos], src, first);
+  if(first<size)
+    memcpy(&m_buffer[0], src+first, size-first);
+  return (pos+size) % m_buffer.size();
+}
+
+size_t LpCapture::copyValuesToBuffer(size_t pos, const value_type* data, size_t n)
+{
+#ifdef USE_FLOAT
+  for(size_t i=0; i<n; i++)
+  {
+    double value = data[i];
+    pos = copyToBuffer(pos, &value, sizeof(double));
+  }
+  return pos;
+#else
+  return copyToBuffer(pos, data, sizeof(double)*n);
+#endif
+}
+
+bool LpCapture::capture(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                        Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub,
+                        Cref_vectorX sol, LP_status status, double solveTime)
+{
+  if(m_file==NULL)
+    return false;
+
+  RecordHeader h;
+  h.magic = RECORD_MAGIC;
+  h.n = c.size();
+  h.m = A.rows();
+  h.status = status;
+  h.reserved = 0;
+  h.solveTime = solveTime;
+  size_t size = recordSize(h.n, h.m);
+  if(size > 0xffffffff)
+  {
+    m_dropped++;
+    return false;
+  }
+  h.size = (uint32_t) size;
+  // A is row major and contiguous only if it is not a block of a larger matrix
+  MatrixXX A_copy;
+  const value_type* A_data = A.data();
+  if(A.outerStride()!=A.cols())
+  {
+    A_copy = A;
+    A_data = A_copy.data();
+  }
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if(m_buffer.size()-m_used < size)
+    {
+      m_dropped++;
+      return false;
+    }
+    size_t pos = (m_readPos+m_used) % m_buffer.size();
+    pos = copyToBuffer(pos, &h, sizeof(h));
+    pos = copyValuesToBuffer(pos, c.data(), h.n);
+    pos = copyValuesToBuffer(pos, lb.data(), h.n);
+    pos = copyValuesToBuffer(pos, ub.data(), h.n);
+    pos = copyValuesToBuffer(pos, A_data, h.n*h.m);
+    pos = copyValuesToBuffer(pos, Alb.data(), h.m);
+    pos = copyValuesToBuffer(pos, Aub.data(), h.m);
+    pos = copyValuesToBuffer(pos, sol.data(), h.n);
+    m_used += size;
+  }
+  m_captured++;
+  m_dataReady.notify_one();
+  return true;
+}
+
+void LpCapture::flush()
+{
+  if(m_file==NULL)
+    return;
+  unique_lock<mutex> lock(m_mutex);
+  m_dataReady.notify_one();
+  while(m_used>0)
+    m_dataWritten.wait(lock);
+}
+
+void LpCapture::writerLoop()
+{
+  unique_lock<mutex> lock(m_mutex);
+  while(true)
+  {
+    while(m_used==0 && !m_stop)
+      m_dataReady.wait(lock);
+    if(m_used==0 && m_stop)
+      break;
+
+    // write the used part of the buffer, which cannot be modified by the producers
+    size_t pos = m_readPos, size = m_used;
+    lock.unlock();
+    size_t first = min(size, m_buffer.size()-pos);
+    bool success = fwrite(&m_buffer[pos], 1, first, m_file)==first;
+    if(first<size)
+      success = success && fwrite(&m_buffer[0], 1, size-first, m_file)==size-first;
+    fflush(m_file);
+    if(!success)
+      SEND_ERROR_MSG("Error while writing LP capture file");
+    lock.lock();
+
+    m_readPos = (m_readPos+size) % m_buffer.size();
+    m_used -= size;
+    m_dataWritten.notify_all();
+  }
+}
+
+bool LpCapture::readFile(const string& filename, vector<CapturedLp>& lps)
+{
+  FILE* f = fopen(filename.c_str(), "rb");
+  if(f==NULL)
+    return false;
+  lps.clear();
+  RecordHeader h;
+  bool success = true;
+  while(fread(&h, sizeof(h), 1, f)==1)
+  {
+    if(h.magic!=RECORD_MAGIC || h.n<0 || h.m<0 || h.size!=recordSize(h.n, h.m))
+    {
+      success = false;
+      break;
+    }
+    CapturedLp lp;
+    lp.status = (LP_status) h.status;
+    lp.solveTime = h.solveTime;
+    lp.c.resize(h.n);
+    lp.lb.resize(h.n);
+    lp.ub.resize(h.n);
+    lp.A.resize(h.m, h.n);
+    lp.Alb.resize(h.m);
+    lp.Aub.resize(h.m);
+    lp.sol.resize(h.n);
+    size_t read = readValues(f, lp.c.data(), h.n);
+    read += readValues(f, lp.lb.data(), h.n);
+    read += readValues(f, lp.ub.data(), h.n);
+    read += readValues(f, lp.A.data(), h.n*h.m);
+    read += readValues(f, lp.Alb.data(), h.m);
+    read += readValues(f, lp.Aub.data(), h.m);
+    read += readValues(f, lp.sol.data(), h.n);
+    if(read != (size_t)(4*h.n + 2*h.m + h.n*h.m))
+    {
+      success = false;
+      break;
+    }
+    lps.push_back(lp);
+  }
+  fclose(f);
+  return success;
+}
+
+} // end namespace robust_equilibrium
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <Windows.h>
+#endif
+
+#include <robust-equilibrium-lib/matrix_archive.hh>
+#include <robust-equilibrium-lib/logger.hh>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+namespace robust_equilibrium
+{
+
+namespace
+{
+  const char      ARCHIVE_MAGIC[8] = {'R','E','Q','L','A','R','C','H'};
+  const uint32_t  ENDIANNESS_MARKER = 0x01020304;
+
+  struct FileHeader
+  {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  endianness;
+    uint64_t  entryCount;
+    uint64_t  indexOffset;
+    uint64_t  indexSize;
+    uint32_t  indexChecksum;
+    uint32_t  reserved;
+  };
+
+  /** Fixed-size part of an entry of the index, followed by the name */
+  struct IndexEntry
+  {
+    uint32_t  type;
+    uint32_t  nameLength;
+    int64_t   rows;
+    int64_t   cols;
+    uint64_t  offset;
+    uint32_t  checksum;
+    uint32_t  reserved;
+  };
+
+  /** Number of doubles stored for an entry */
+  uint64_t entrySize(uint32_t type, int64_t rows, int64_t cols)
+  {
+    if(type==ARCHIVE_ENTRY_LP)   // rows constraints, cols variables
+      return 3*cols + rows*cols + 2*rows;
+    return rows*cols;
+  }
+}
+
+namespace
+{
+  /** Lookup table of the CRC-32 (polynomial 0xEDB88320) */
+  struct Crc32Table
+  {
+    uint32_t values[256];
+    Crc32Table()
+    {
+      for(uint32_t i=0; i<256; i++)
+      {
+        uint32_t c = i;
+        for(int k=0; k<8; k++)
+          c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+        values[i] = c;
+      }
+    }
+  };
+}
+
+uint32_t computeCrc32(const void* data, size_t size, uint32_t crc)
+{
+  static const Crc32Table table;
+  const unsigned char* p = (const unsigned char*) data;
+  crc = ~crc;
+  for(size_t i=0; i<size; i++)
+    crc = table.values[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+/********************************************************************************/
+/******************************** WRITER ****************************************/
+/********************************************************************************/
+
+MatrixArchiveWriter::MatrixArchiveWriter()
+  : m_file(NULL), m_offset(0), m_success(true)
+{}
+
+MatrixArchiveWriter::~MatrixArchiveWriter()
+{
+  close();
+}
+
+bool MatrixArchiveWriter::open(const string& filename)
+{
+  close();
+  m_file = fopen(filename.c_str(), "wb");
+  if(m_file==NULL)
+  {
+    SEND_ERROR_MSG("Impossible to create archive "+filename);
+    return false;
+  }
+  m_entries.clear();
+  m_names.clear();
+  m_success = true;
+  // the header is written by close, for now leave space for it
+  FileHeader h;
+  memset(&h, 0, sizeof(h));
+  m_success = fwrite(&h, sizeof(h), 1, m_file)==1;
+  m_offset = sizeof(h);
+  return m_success;
+}
+
+bool MatrixArchiveWriter::beginEntry(const string& name, ArchiveEntryType type, int64_t rows, int64_t cols)
+{
+  if(m_file==NULL)
+  {
+    SEND_ERROR_MSG("Archive is not open");
+    return false;
+  }
+  if(m_names.find(name)!=m_names.end())
+  {
+    SEND_ERROR_MSG("Archive already contains an entry named "+name);
+    return false;
+  }
+  // align the data
+  static const char zeros[ARCHIVE_ALIGNMENT] = {0};
+  size_t padding = (ARCHIVE_ALIGNMENT - m_offset%ARCHIVE_ALIGNMENT) % ARCHIVE_ALIGNMENT;
+  if(padding>0)
+    m_success = m_success && fwrite(zeros, 1, padding, m_file)==padding;
+  m_offset += padding;
+
+  Entry e;
+  e.name = name;
+  e.type = type;
+  e.rows = rows;
+  e.cols = cols;
+  e.offset = m_offset;
+  e.checksum = 0;
+  m_names[name] = (int)m_entries.size();
+  m_entries.push_back(e);
+  return true;
+}
+
+void MatrixArchiveWriter::writeData(const value_type* values, size_t size)
+{
+#ifdef USE_FLOAT
+  m_buffer.assign(values, values+size);
+  const double* data = m_buffer.data();
+#else
+  const double* data = values;
+#endif
+  Entry& e = m_entries.back();
+  e.checksum = computeCrc32(data, size*sizeof(double), e.checksum);
+  m_success = m_success && fwrite(data, sizeof(double), size, m_file)==size;
+  m_offset += size*sizeof(double);
+}
+
+bool MatrixArchiveWriter::addMatrix(const string& name, Cref_matrixXX matrix)
+{
+  if(!beginEntry(name, ARCHIVE_ENTRY_MATRIX, matrix.rows(), matrix.cols()))
+    return false;
+  for(MatrixXX::Index i=0; i<matrix.rows(); i++)
+    writeData(matrix.row(i).data(), matrix.cols());
+  return m_success;
+}
+
+bool MatrixArchiveWriter::addLp(const string& name, Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                                Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub)
+{
+  const MatrixXX::Index n=c.size(), m=A.rows();
+  if(lb.size()!=n || ub.size()!=n || A.cols()!=n || Alb.size()!=m || Aub.size()!=m)
+  {
+    SEND_ERROR_MSG("Inconsistent sizes of LP "+name);
+    return false;
+  }
+  if(!beginEntry(name, ARCHIVE_ENTRY_LP, m, n))
+    return false;
+  writeData(c.data(), n);
+  writeData(lb.data(), n);
+  writeData(ub.data(), n);
+  for(MatrixXX::Index i=0; i<m; i++)
+    writeData(A.row(i).data(), n);
+  writeData(Alb.data(), m);
+  writeData(Aub.data(), m);
+  return m_success;
+}
+
+bool MatrixArchiveWriter::close()
+{
+  if(m_file==NULL)
+    return false;
+
+  // serialize the index
+  vector<char> index;
+  for(size_t i=0; i<m_entries.size(); i++)
+  {
+    const Entry& e = m_entries[i];
+    IndexEntry ie;
+    memset(&ie, 0, sizeof(ie));
+    ie.type = e.type;
+    ie.nameLength = (uint32_t)e.name.size();
+    ie.rows = e.rows;
+    ie.cols = e.cols;
+    ie.offset = e.offset;
+    ie.checksum = e.checksum;
+    index.insert(index.end(), (const char*)&ie, (const char*)&ie+sizeof(ie));
+    index.insert(index.end(), e.name.begin(), e.name.end());
+  }
+
+  FileHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, ARCHIVE_MAGIC, sizeof(h.magic));
+  h.version = ARCHIVE_VERSION;
+  h.endianness = ENDIANNESS_MARKER;
+  h.entryCount = m_entries.size();
+  h.indexOffset = m_offset;
+  h.indexSize = index.size();
+  h.indexChecksum = computeCrc32(index.data(), index.size());
+
+  if(!index.empty())
+    m_success = m_success && fwrite(index.data(), 1, index.size(), m_file)==index.size();
+  m_success = m_success && fseek(m_file, 0, SEEK_SET)==0;
+  m_success = m_success && fwrite(&h, sizeof(h), 1, m_file)==1;
+  m_success = (fclose(m_file)==0) && m_success;
+  m_file = NULL;
+  if(!m_success)
+    SEND_ERROR_MSG("Error while writing archive");
+  return m_success;
+}
+
+/********************************************************************************/
+/******************************** READER ****************************************/
+/********************************************************************************/
+
+MatrixArchive::MatrixArchive()
+  : m_data(NULL), m_size(0)
+#ifdef WIN32
+  , m_fileHandle(NULL), m_mappingHandle(NULL)
+#endif
+{}
+
+MatrixArchive::~MatrixArchive()
+{
+  close();
+}
+
+bool MatrixArchive::open(const string& filename)
+{
+  close();
+
+#ifndef WIN32
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd<0)
+  {
+    SEND_ERROR_MSG("Impossible to open archive "+filename);
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(FileHeader))
+  {
+    ::close(fd);
+    SEND_ERROR_MSG("Archive "+filename+" is too small");
+    return false;
+  }
+  m_size = st.st_size;
+  void* mapped = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps the file open
+  if(mapped==MAP_FAILED)
+  {
+    m_size = 0;
+    SEND_ERROR_MSG("Impossible to map archive "+filename);
+    return false;
+  }
+  m_data = (const char*) mapped;
+#else
+  m_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+  if(m_fileHandle==INVALID_HANDLE_VALUE)
+  {
+    m_fileHandle = NULL;
+    SEND_ERROR_MSG("Impossible to open archive "+filename);
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(m_fileHandle, &fileSize);
+  m_size = (size_t) fileSize.QuadPart;
+  m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if(m_size<sizeof(FileHeader) || m_mappingHandle==NULL)
+  {
+    close();
+    SEND_ERROR_MSG("Impossible to map archive "+filename);
+    return false;
+  }
+  m_data = (const char*) MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+  if(m_data==NULL)
+  {
+    close();
+    SEND_ERROR_MSG("Impossible to map archive "+filename);
+    return false;
+  }
+#endif
+
+  FileHeader h;
+  memcpy(&h, m_data, sizeof(h));
+  string error = "";
+  if(memcmp(h.magic, ARCHIVE_MAGIC, sizeof(h.magic))!=0)
+    error = "is not an archive";
+  else if(h.endianness!=ENDIANNESS_MARKER)
+    error = "has been written with a different byte order";
+  else if(h.version!=ARCHIVE_VERSION)
+    error = "has unsupported version "+toString(h.version);
+  else if(h.indexOffset>m_size || h.indexSize>m_size-h.indexOffset)
+    error = "is truncated";
+  else if(computeCrc32(m_data+h.indexOffset, h.indexSize)!=h.indexChecksum)
+    error = "has a corrupted index";
+  if(error!="")
+  {
+    close();
+    SEND_ERROR_MSG("Archive "+filename+" "+error);
+    return false;
+  }
+
+  const char* p = m_data+h.indexOffset;
+  const char* end = p+h.indexSize;
+  m_entries.resize(h.entryCount);
+  for(size_t i=0; i<h.entryCount; i++)
+  {
+    IndexEntry ie;
+    if(end-p<(ptrdiff_t)sizeof(ie))
+      break;
+    memcpy(&ie, p, sizeof(ie));
+    p += sizeof(ie);
+    if(end-p<(ptrdiff_t)ie.nameLength || ie.rows<0 || ie.cols<0 || ie.offset%sizeof(double)!=0 ||
+       ie.offset>h.indexOffset ||
+       entrySize(ie.type, ie.rows, ie.cols) > (h.indexOffset-ie.offset)/sizeof(double))
+    {
+      error = "has an invalid entry";
+      break;
+    }
+    Entry& e = m_entries[i];
+    e.name.assign(p, ie.nameLength);
+    p += ie.nameLength;
+    e.type = ie.type;
+    e.rows = ie.rows;
+    e.cols = ie.cols;
+    e.offset = ie.offset;
+    e.checksum = ie.checksum;
+    m_names[e.name] = (int)i;
+  }
+  if(error=="" && (p!=end || m_names.size()!=h.entryCount))
+    error = "has an invalid index";
+  if(error!="")
+  {
+    close();
+    SEND_ERROR_MSG("Archive "+filename+" "+error);
+    return false;
+  }
+  return true;
+}
+
+void MatrixArchive::close()
+{
+#ifndef WIN32
+  if(m_data!=NULL)
+    munmap((void*)m_data, m_size);
+#else
+  if(m_data!=NULL)
+    UnmapViewOfFile(m_data);
+  if(m_mappingHandle!=NULL)
+    CloseHandle(m_mappingHandle);
+  if(m_fileHandle!=NULL)
+    CloseHandle(m_fileHandle);
+  m_mappingHandle = NULL;
+  m_fileHandle = NULL;
+#endif
+  m_data = NULL;
+  m_size = 0;
+  m_entries.clear();
+  m_names.clear();
+}
+
+const MatrixArchive::Entry* MatrixArchive::find(const string& name, ArchiveEntryType type) const
+{
+  map<string,int>::const_iterator it = m_names.find(name);
+  if(it==m_names.end() || m_entries[it->second].type!=(uint32_t)type)
+    return NULL;
+  return &m_entries[it->second];
+}
+
+bool MatrixArchive::getMatrix(const string& name, MatrixView& view) const
+{
+  const Entry* e = find(name, ARCHIVE_ENTRY_MATRIX);
+  if(e==NULL)
+    return false;
+  // Eigen::Map cannot be reassigned, but it can be constructed again in place
+  new (&view) MatrixView(data(*e), e->rows, e->cols);
+  return true;
+}
+
+bool MatrixArchive::getLp(const string& name, LpView& view) const
+{
+  const Entry* e = find(name, ARCHIVE_ENTRY_LP);
+  if(e==NULL)
+    return false;
+  const int64_t n=e->cols, m=e->rows;
+  const double* p = data(*e);
+  new (&view.c)   VectorView(p, n);       p += n;
+  new (&view.lb)  VectorView(p, n);       p += n;
+  new (&view.ub)  VectorView(p, n);       p += n;
+  new (&view.A)   MatrixView(p, m, n);    p += m*n;
+  new (&view.Alb) VectorView(p, m);       p += m;
+  new (&view.Aub) VectorView(p, m);
+  return true;
+}
+
+bool MatrixArchive::readMatrix(const string& name, MatrixXX& matrix) const
+{
+  MatrixView view(NULL, 0, 0);
+  if(!getMatrix(name, view))
+    return false;
+  matrix = view.cast<value_type>();
+  return true;
+}
+
+bool MatrixArchive::verify(const string& name) const
+{
+  map<string,int>::const_iterator it = m_names.find(name);
+  if(it==m_names.end())
+    return false;
+  const Entry& e = m_entries[it->second];
+  return computeCrc32(data(e), entrySize(e.type, e.rows, e.cols)*sizeof(double))==e.checksum;
+}
+
+} // end namespace robust_equilibrium
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#include <robust-equilibrium-lib/polytope_cache.hh>
+#include <cmath>
+
+using namespace std;
+
+namespace robust_equilibrium
+{
+
+PolytopeCache::PolytopeCache(size_t memoryBudget, double resolution)
+  : m_memoryBudget(memoryBudget),
+    m_memoryUsage(0),
+    m_resolution(resolution),
+    m_hits(0),
+    m_misses(0),
+    m_evictions(0)
+{}
+
+PolytopeCache::Key PolytopeCache::computeKey(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals,
+                                             double frictionCoefficient, unsigned int generatorsPerContact,
+                                             double mass) const
+{
+  Key key;
+  key.values.reserve(3 + 6*contactPoints.rows());
+  key.values.push_back(generatorsPerContact);
+  key.values.push_back(llround(frictionCoefficient/m_resolution));
+  key.values.push_back(llround(mass/m_resolution));
+  for(long i=0; i<contactPoints.rows(); i++)
+    for(int j=0; j<3; j++)
+      key.values.push_back(llround(contactPoints(i,j)/m_resolution));
+  for(long i=0; i<contactNormals.rows(); i++)
+    for(int j=0; j<3; j++)
+      key.values.push_back(llround(contactNormals(i,j)/m_resolution));
+
+  // FNV-1a hash of the quantized values
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i=0; i<key.values.size(); i++)
+  {
+    hash ^= (uint64_t) key.values[i];
+    hash *= 1099511628211ULL;
+  }
+  key.hash = (size_t) hash;
+  return key;
+}
+
+bool PolytopeCache::find(const Key& key, Entry& entry)
+{
+  lock_guard<mutex> lock(m_mutex);
+  unordered_map<Key, EntryList::iterator, KeyHash>::iterator it = m_index.find(key);
+  if(it==m_index.end())
+  {
+    m_misses++;
+    return false;
+  }
+  m_hits++;
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  entry = it->second->second;
+  return true;
+}
+
+void PolytopeCache::insert(const Key& key, const Entry& entry)
+{
+  size_t size = memorySize(key, entry);
+  lock_guard<mutex> lock(m_mutex);
+  if(size>m_memoryBudget || m_index.find(key)!=m_index.end())
+    return;
+  m_entries.push_front(make_pair(key, entry));
+  m_index[key] = m_entries.begin();
+  m_memoryUsage += size;
+  evict();
+}
+
+void PolytopeCache::clear()
+{
+  lock_guard<mutex> lock(m_mutex);
+  m_entries.clear();
+  m_index.clear();
+  m_memoryUsage = 0;
+}
+
+void PolytopeCache::setMemoryBudget(size_t memoryBudget)
+{
+  lock_guard<mutex> lock(m_mutex);
+  m_memoryBudget = memoryBudget;
+  evict();
+}
+
+size_t PolytopeCache::getMemoryBudget() const
+{
+  lock_guard<mutex> lock(m_mutex);
+  return m_memoryBudget;
+}
+
+size_t PolytopeCache::getMemoryUsage() const
+{
+  lock_guard<mutex> lock(m_mutex);
+  return m_memoryUsage;
+}
+
+size_t PolytopeCache::size() const
+{
+  lock_guard<mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void PolytopeCache::resetCounters()
+{
+  m_hits = 0;
+  m_misses = 0;
+  m_evictions = 0;
+}
+
+size_t PolytopeCache::memorySize(const Key& key, const Entry& entry)
+{
+  return sizeof(pair<Key, Entry>) + sizeof(EntryList::iterator) + sizeof(int64_t)*key.values.size() +
+         sizeof(value_type)*(entry.H.size() + entry.h.size() + entry.HD.size() + entry.Hd.size() + entry.HG1.size());
+}
+
+void PolytopeCache::evict()
+{
+  while(m_memoryUsage>m_memoryBudget && !m_entries.empty())
+  {
+    m_memoryUsage -= memorySize(m_entries.back().first, m_entries.back().second);
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+    m_evictions++;
+  }
+}
+
+} // end namespace robust_equilibrium
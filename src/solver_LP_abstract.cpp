@@ -5,8 +5,11 @@
 
 #include <robust-equilibrium-lib/solver_LP_abstract.hh>
 #include <robust-equilibrium-lib/solver_LP_qpoases.hh>
+#include <robust-equilibrium-lib/lp_capture.hh>
 #include <robust-equilibrium-lib/logger.hh>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 #ifdef CLP_FOUND
 #include <robust-equilibrium-lib/solver_LP_clp.hh>
@@ -18,6 +21,64 @@ using namespace std;
 namespace robust_equilibrium
 {
 
+namespace
+{
+  std::mutex                  lp_capture_mutex; // serializes start and stop of the LP capture
+  std::shared_ptr<LpCapture>  lp_capture;       // accessed with atomic_load/atomic_store
+}
+
+std::atomic<bool> Solver_LP_abstract::s_lpCaptureActive(false);
+
+bool Solver_LP_abstract::startLpCapture(const std::string& filename)
+{
+  return startLpCapture(filename, LpCaptureOptions());
+}
+
+bool Solver_LP_abstract::startLpCapture(const std::string& filename, const LpCaptureOptions& options)
+{
+  stopLpCapture();
+  std::shared_ptr<LpCapture> capture = std::make_shared<LpCapture>(filename, options);
+  if(!capture->isOpen())
+    return false;
+  std::lock_guard<std::mutex> lock(lp_capture_mutex);
+  std::atomic_store(&lp_capture, capture);
+  s_lpCaptureActive = true;
+  return true;
+}
+
+void Solver_LP_abstract::stopLpCapture()
+{
+  std::shared_ptr<LpCapture> capture;
+  {
+    std::lock_guard<std::mutex> lock(lp_capture_mutex);
+    s_lpCaptureActive = false;
+    capture = std::atomic_exchange(&lp_capture, std::shared_ptr<LpCapture>());
+  }
+  // the capture is destroyed (and flushed) when the last solver using it releases it
+}
+
+void Solver_LP_abstract::flushLpCapture()
+{
+  std::shared_ptr<LpCapture> capture = std::atomic_load(&lp_capture);
+  if(capture)
+    capture->flush();
+}
+
+bool Solver_LP_abstract::shouldCaptureLp(double solveTime, LP_status status)
+{
+  std::shared_ptr<LpCapture> capture = std::atomic_load(&lp_capture);
+  return capture && capture->shouldCapture(solveTime, status);
+}
+
+void Solver_LP_abstract::captureLp(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                                   Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub,
+                                   Cref_vectorX sol, LP_status status, double solveTime)
+{
+  std::shared_ptr<LpCapture> capture = std::atomic_load(&lp_capture);
+  if(capture)
+    capture->capture(c, lb, ub, A, Alb, Aub, sol, status, solveTime);
+}
+
 Solver_LP_abstract* Solver_LP_abstract::getNewSolver(SolverLP solverType)
 {
   if(solverType==SOLVER_LP_QPOASES)
@@ -46,12 +107,15 @@ bool Solver_LP_abstract::writeLpToFile(const std::string& filename,
   std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   out.write((char*) (&n), sizeof(typename MatrixXX::Index));
   out.write((char*) (&m), sizeof(typename MatrixXX::Index));
-  out.write((char*) c.data(), n*sizeof(typename MatrixXX::Scalar) );
-  out.write((char*) lb.data(), n*sizeof(typename MatrixXX::Scalar) );
-  out.write((char*) ub.data(), n*sizeof(typename MatrixXX::Scalar) );
-  out.write((char*) A.data(), m*n*sizeof(typename MatrixXX::Scalar) );
-  out.write((char*) Alb.data(), m*sizeof(typename MatrixXX::Scalar) );
-  out.write((char*) Aub.data(), m*sizeof(typename MatrixXX::Scalar) );
+  // the values are always written in double precision
+  VectorX_d buffer;
+  MatrixXX_d A_buffer;
+  out.write((char*) doubleData(c, buffer), n*sizeof(double) );
+  out.write((char*) doubleData(lb, buffer), n*sizeof(double) );
+  out.write((char*) doubleData(ub, buffer), n*sizeof(double) );
+  out.write((char*) doubleData(A, A_buffer), m*n*sizeof(double) );
+  out.write((char*) doubleData(Alb, buffer), m*sizeof(double) );
+  out.write((char*) doubleData(Aub, buffer), m*sizeof(double) );
   out.close();
   return true;
 }
@@ -64,18 +128,20 @@ bool Solver_LP_abstract::readLpFromFile(const std::string& filename,
   typename MatrixXX::Index n=0, m=0;
   in.read((char*) (&n),sizeof(typename MatrixXX::Index));
   in.read((char*) (&m),sizeof(typename MatrixXX::Index));
-  c.resize(n);
-  lb.resize(n);
-  ub.resize(n);
-  A.resize(m,n);
-  Alb.resize(m);
-  Aub.resize(m);
-  in.read( (char *) c.data() , n*sizeof(typename MatrixXX::Scalar) );
-  in.read( (char *) lb.data() , n*sizeof(typename MatrixXX::Scalar) );
-  in.read( (char *) ub.data() , n*sizeof(typename MatrixXX::Scalar) );
-  in.read( (char *) A.data() , m*n*sizeof(typename MatrixXX::Scalar) );
-  in.read( (char *) Alb.data() , m*sizeof(typename MatrixXX::Scalar) );
-  in.read( (char *) Aub.data() , m*sizeof(typename MatrixXX::Scalar) );
+  VectorX_d c_d(n), lb_d(n), ub_d(n), Alb_d(m), Aub_d(m);
+  MatrixXX_d A_d(m,n);
+  in.read( (char *) c_d.data() , n*sizeof(double) );
+  in.read( (char *) lb_d.data() , n*sizeof(double) );
+  in.read( (char *) ub_d.data() , n*sizeof(double) );
+  in.read( (char *) A_d.data() , m*n*sizeof(double) );
+  in.read( (char *) Alb_d.data() , m*sizeof(double) );
+  in.read( (char *) Aub_d.data() , m*sizeof(double) );
+  c = c_d.cast<value_type>();
+  lb = lb_d.cast<value_type>();
+  ub = ub_d.cast<value_type>();
+  A = A_d.cast<value_type>();
+  Alb = Alb_d.cast<value_type>();
+  Aub = Aub_d.cast<value_type>();
   in.close();
   return true;
 }
@@ -6,7 +6,7 @@
 #ifdef CLP_FOUND
 
 #include <robust-equilibrium-lib/solver_LP_clp.hh>
-#include "CoinBuild.hpp"
+#include <chrono>
 
 namespace robust_equilibrium
 {
@@ -28,38 +28,139 @@ LP_status Solver_LP_clp::solve(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
   assert(Alb.size()==m);
   assert(Aub.size()==m);
 
-  m_model.resize(0, n);
-  int* rowIndex = new int[n];
+  const bool capture = isLpCaptureActive();
+  std::chrono::steady_clock::time_point start;
+  if(capture)
+    start = std::chrono::steady_clock::now();
 
-  for(int i=0; i<n; i++)
+  // If the constraint matrix has not changed since the last call only the vectors are updated,
+  // so that the model (and its basis) is kept. Otherwise the nonzero elements of A are packed
+  // column by column and the whole problem is loaded again.
+  if(m_A.rows()==m && m_A.cols()==n && m_A==A)
   {
-    m_model.setObjectiveCoefficient(i, c(i));
-    m_model.setColumnLower(i, lb(i));
-    m_model.setColumnUpper(i, ub(i));
-    rowIndex[i] = i;
+    m_model.chgObjCoefficients(doubleData(c, m_c_d));
+    m_model.chgColumnLower(doubleData(lb, m_lb_d));
+    m_model.chgColumnUpper(doubleData(ub, m_ub_d));
+    m_model.chgRowLower(doubleData(Alb, m_Alb_d));
+    m_model.chgRowUpper(doubleData(Aub, m_Aub_d));
   }
+  else
+    loadDenseProblem(c, lb, ub, A, Alb, Aub);
 
-//  m_model.allSlackBasis();
+  LP_status status = solveLoadedModel(sol);
+  if(capture)
+  {
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    if(shouldCaptureLp(time, status))
+      captureLp(c, lb, ub, A, Alb, Aub, sol, status, time);
+  }
+  return status;
+}
+
+void Solver_LP_clp::loadDenseProblem(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                                     Cref_matrixXX A, Cref_vectorX Alb, Cref_vectorX Aub)
+{
+  int n = (int)c.size();  // number of variables
+  int m = (int)A.rows();  // number of constraints
+  m_A = A;
+  m_elements.clear();
+  m_rowIndex.clear();
+  m_starts.resize(n+1);
+  m_lengths.resize(n);
+  for(int j=0; j<n; j++)
+  {
+    m_starts[j] = (CoinBigIndex)m_elements.size();
+    for(int i=0; i<m; i++)
+    {
+      if(A(i,j)!=0.0)
+      {
+        m_elements.push_back(A(i,j));
+        m_rowIndex.push_back(i);
+      }
+    }
+    m_lengths[j] = (int)m_elements.size() - m_starts[j];
+  }
+  m_starts[n] = (CoinBigIndex)m_elements.size();
+
+  CoinPackedMatrix matrix(true, m, n, (CoinBigIndex)m_elements.size(),
+                          m_elements.data(), m_rowIndex.data(), m_starts.data(), m_lengths.data());
+  loadProblem(matrix, c, lb, ub, Alb, Aub);
+}
+
+LP_status Solver_LP_clp::solve(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                               const CoinPackedMatrix &A, Cref_vectorX Alb, Cref_vectorX Aub,
+                               Ref_vectorX sol)
+{
+  assert(lb.size()==c.size());
+  assert(ub.size()==c.size());
+  assert(Aub.size()==Alb.size());
+
+  const bool capture = isLpCaptureActive();
+  std::chrono::steady_clock::time_point start;
+  if(capture)
+    start = std::chrono::steady_clock::now();
 
-  // This is not the most efficient way to pass the data to the problem
-  // but it is the best compromise between efficiency and simplicity.
-  // We could be more efficient by using CoinPackedMatrix and ClpPackedMatrix
-  // as shown in the example file "addRows.cpp"
-  CoinBuild buildObject;
-  for (int i=0; i<m; i++)
+  // the dense copy of the constraint matrix is not available anymore
+  m_A.resize(0,0);
+  loadProblem(A, c, lb, ub, Alb, Aub);
+  LP_status status = solveLoadedModel(sol);
+
+  if(capture)
   {
-    buildObject.addRow(n, rowIndex, A.row(i).data(), Alb(i), Aub(i));
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    if(shouldCaptureLp(time, status))
+    {
+      // the dense matrix is built only for the LPs that are actually captured
+      MatrixXX A_dense = MatrixXX::Zero(A.getNumRows(), A.getNumCols());
+      const double* elements = A.getElements();
+      const int* indices = A.getIndices();
+      const CoinBigIndex* starts = A.getVectorStarts();
+      const int* lengths = A.getVectorLengths();
+      for(int j=0; j<A.getMajorDim(); j++)
+        for(CoinBigIndex k=starts[j]; k<starts[j]+lengths[j]; k++)
+        {
+          if(A.isColOrdered())
+            A_dense(indices[k], j) = elements[k];
+          else
+            A_dense(j, indices[k]) = elements[k];
+        }
+      captureLp(c, lb, ub, A_dense, Alb, Aub, sol, status, time);
+    }
   }
-  m_model.addRows(buildObject);
+  return status;
+}
 
-  // solve the problem
-  m_model.primal();
-//  m_model.dual();
+void Solver_LP_clp::loadProblem(const CoinPackedMatrix &A, Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
+                                Cref_vectorX Alb, Cref_vectorX Aub)
+{
+  const int n = (int)c.size();
+  const int m = (int)Alb.size();
+  const bool keepBasis = m_useWarmStart && m_model.statusArray()!=NULL &&
+                         m_model.numberColumns()==n && m_model.numberRows()==m;
+  if(keepBasis)
+    m_basis.assign(m_model.statusArray(), m_model.statusArray()+n+m);
+
+  m_model.loadProblem(A, doubleData(lb, m_lb_d), doubleData(ub, m_ub_d), doubleData(c, m_c_d),
+                      doubleData(Alb, m_Alb_d), doubleData(Aub, m_Aub_d));
+
+  if(keepBasis)
+    m_model.copyinStatus(m_basis.data());
+}
+
+LP_status Solver_LP_clp::solveLoadedModel(Ref_vectorX sol)
+{
+  if(m_useWarmStart && m_model.statusArray()!=NULL)
+    m_model.dual();
+  else
+  {
+    m_model.allSlackBasis(true);
+    m_model.primal();
+  }
 
   if(m_model.isProvenOptimal())
   {
     const double *solution = m_model.getColSolution();
-    for(int i=0; i<n; i++)
+    for(int i=0; i<sol.size(); i++)
       sol(i) = solution[i];
   }
 
@@ -79,6 +180,11 @@ double Solver_LP_clp::getObjectiveValue()
   return m_model.objectiveValue();
 }
 
+unsigned int Solver_LP_clp::getNumberOfIterations()
+{
+  return m_model.numberIterations();
+}
+
 void Solver_LP_clp::getDualSolution(Ref_vectorX res)
 {
   const double *tmp = m_model.dualRowSolution();
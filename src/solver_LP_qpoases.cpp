@@ -5,6 +5,8 @@
 
 #include <robust-equilibrium-lib/solver_LP_qpoases.hh>
 #include <robust-equilibrium-lib/logger.hh>
+#include <chrono>
+#include <algorithm>
 
 USING_NAMESPACE_QPOASES
 
@@ -19,6 +21,9 @@ namespace robust_equilibrium
     m_options.printLevel          = PL_NONE; //PL_LOW
     m_options.enableRegularisation = BT_TRUE;
     m_options.enableEqualities = BT_TRUE;
+    m_iterations = 0;
+    m_maxProblems = 4;
+    m_problem = NULL;
   }
 
   LP_status Solver_LP_qpoases::solve(Cref_vectorX c, Cref_vectorX lb, Cref_vectorX ub,
@@ -33,39 +38,121 @@ namespace robust_equilibrium
     assert(Alb.size()==m);
     assert(Aub.size()==m);
 
+    const bool capture = isLpCaptureActive();
+    std::chrono::steady_clock::time_point start;
+    if(capture)
+      start = std::chrono::steady_clock::now();
+
     int iters = m_maxIter;
     double solutionTime = m_maxTime;
-    if(n!=m_solver.getNV() || m!=m_solver.getNC())
+    ProblemSize size(n, m);
+    ProblemMap::iterator it = m_problems.find(size);
+    if(it==m_problems.end())
     {
-      m_solver = SQProblem(n, m, HST_ZERO);
-      m_solver.setOptions(m_options);
-//      m_solver.printOptions();
-      m_init_succeeded = false;
-      m_H = MatrixXX::Zero(n,n);
+      // delete the solver of the least recently used size to make room for the new one
+      if(m_problems.size()>=m_maxProblems)
+      {
+        m_problems.erase(m_lru.back());
+        m_lru.pop_back();
+      }
+      it = m_problems.insert(std::make_pair(size, Problem())).first;
+      it->second.solver = SQProblem(n, m, HST_ZERO);
+      it->second.solver.setOptions(m_options);
+      it->second.init_succeeded = false;
+      m_lru.push_front(size);
+      it->second.lru_position = m_lru.begin();
     }
+    else
+      m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+    m_problem = &(it->second);
+    Problem &p = *m_problem;
+
+    // qpOASES works in double precision: convert the data if value_type is float
+    const double *c_d=doubleData(c, m_c_d), *lb_d=doubleData(lb, m_lb_d), *ub_d=doubleData(ub, m_ub_d);
+    const double *Alb_d=doubleData(Alb, m_Alb_d), *Aub_d=doubleData(Aub, m_Aub_d);
 
-    if(!m_useWarmStart || !m_init_succeeded)
+    if(!m_useWarmStart || !p.init_succeeded)
     {
-      m_status = m_solver.init(NULL, c.data(), A.data(), lb.data(), ub.data(),
-                               Alb.data(), Aub.data(), iters, &solutionTime);
+      m_status = p.solver.init(NULL, c_d, doubleData(A, m_A_d), lb_d, ub_d,
+                               Alb_d, Aub_d, iters, &solutionTime);
       if(m_status==SUCCESSFUL_RETURN)
-        m_init_succeeded = true;
+      {
+        p.init_succeeded = true;
+        p.A = A;
+      }
     }
-    else
+    else if(p.A==A)
     {
-      // this doesn't work if I pass NULL instead of m_H.data()
-      m_status = m_solver.hotstart(m_H.data(), c.data(), A.data(), lb.data(), ub.data(),
-                                  Alb.data(), Aub.data(), iters, &solutionTime);
+      // constant constraint matrix: only the vectors need to be passed to the solver
+      m_status = p.solver.QProblem::hotstart(c_d, lb_d, ub_d,
+                                             Alb_d, Aub_d, iters, &solutionTime);
       if(m_status!=SUCCESSFUL_RETURN)
-        m_init_succeeded = false;
+        p.init_succeeded = false;
     }
+    else
+    {
+      // this doesn't work if I pass NULL instead of the Hessian matrix
+      if(p.H.rows()!=n)
+        p.H = MatrixXX_d::Zero(n,n);
+      m_status = p.solver.hotstart(p.H.data(), c_d, doubleData(A, m_A_d), lb_d, ub_d,
+                                   Alb_d, Aub_d, iters, &solutionTime);
+      if(m_status==SUCCESSFUL_RETURN)
+        p.A = A;
+      else
+        p.init_succeeded = false;
+    }
+
+    m_iterations = iters;
 
     if(m_status==SUCCESSFUL_RETURN)
     {
-      m_solver.getPrimalSolution(sol.data());
+#ifdef USE_FLOAT
+      m_x_d.resize(n);
+      p.solver.getPrimalSolution(m_x_d.data());
+      sol = m_x_d.cast<value_type>();
+#else
+      p.solver.getPrimalSolution(sol.data());
+#endif
+    }
+
+    LP_status status = getStatus();
+    if(capture)
+    {
+      double time = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+      if(shouldCaptureLp(time, status))
+        captureLp(c, lb, ub, A, Alb, Aub, sol, status, time);
     }
+    return status;
+  }
+
+  void Solver_LP_qpoases::getDualSolution(Ref_vectorX res)
+  {
+    // qpOASES returns the multipliers of the bounds followed by the ones of the constraints
+    if(m_problem==NULL)
+      return;
+    const qpOASES::SQProblem &solver = m_problem->solver;
+    m_dual.resize(solver.getNV()+solver.getNC());
+    solver.getDualSolution(m_dual.data());
+    res = m_dual.tail(solver.getNC()).cast<value_type>();
+  }
 
-    return getStatus();
+  void Solver_LP_qpoases::clearWarmStartData()
+  {
+    m_problems.clear();
+    m_lru.clear();
+    m_problem = NULL;
+  }
+
+  void Solver_LP_qpoases::setMaximumNumberOfProblems(unsigned int maxProblems)
+  {
+    m_maxProblems = std::max(1u, maxProblems);
+    while(m_problems.size()>m_maxProblems)
+    {
+      if(m_problem==&m_problems.find(m_lru.back())->second)
+        m_problem = NULL;
+      m_problems.erase(m_lru.back());
+      m_lru.pop_back();
+    }
   }
 
   LP_status Solver_LP_qpoases::getStatus()
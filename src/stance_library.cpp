@@ -0,0 +1,50 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#include <robust-equilibrium-lib/stance_library.hh>
+#include <robust-equilibrium-lib/logger.hh>
+
+using namespace std;
+
+namespace robust_equilibrium
+{
+
+bool StanceLibrary::open(const string& filename)
+{
+  close();
+  if(!m_archive.open(filename))
+    return false;
+  // each stance has an entry "name/info"
+  const string INFO = "/info";
+  for(size_t i=0; i<m_archive.size(); i++)
+  {
+    const string& entry = m_archive.getName(i);
+    if(entry.size()>INFO.size() && entry.compare(entry.size()-INFO.size(), INFO.size(), INFO)==0)
+    {
+      m_index[entry.substr(0, entry.size()-INFO.size())] = (int)m_names.size();
+      m_names.push_back(entry.substr(0, entry.size()-INFO.size()));
+    }
+  }
+  return true;
+}
+
+void StanceLibrary::close()
+{
+  m_archive.close();
+  m_names.clear();
+  m_index.clear();
+}
+
+bool StanceLibrary::loadStance(const string& name, StaticEquilibrium& se) const
+{
+  if(!contains(name))
+  {
+    SEND_ERROR_MSG("Stance library does not contain stance "+name);
+    return false;
+  }
+  return se.loadContactState(m_archive, name);
+}
+
+} // end namespace robust_equilibrium
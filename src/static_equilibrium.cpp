@@ -6,25 +6,25 @@
 #include <robust-equilibrium-lib/static_equilibrium.hh>
 #include <robust-equilibrium-lib/logger.hh>
 #include <robust-equilibrium-lib/stop-watch.hh>
+#include <robust-equilibrium-lib/matrix_archive.hh>
 #include <iostream>
 #include <vector>
 #include <ctime>
+#include <thread>
+#include <mutex>
+#include <algorithm>
 
 using namespace std;
 
 namespace robust_equilibrium
 {
 
-bool StaticEquilibrium::m_is_cdd_initialized = false;
+std::mutex StaticEquilibrium::m_cdd_mutex;
 
 StaticEquilibrium::StaticEquilibrium(string name, double mass, unsigned int generatorsPerContact,
                                      SolverLP solver_type, bool useWarmStart)
 {
-  if(!m_is_cdd_initialized)
-  {
-    init_cdd_library();
-    m_is_cdd_initialized = true;
-  }
+  init_cdd_library();
 
   if(generatorsPerContact<3)
   {
@@ -36,7 +36,12 @@ StaticEquilibrium::StaticEquilibrium(string name, double mass, unsigned int gene
   m_solver_type = solver_type;
   m_solver = Solver_LP_abstract::getNewSolver(solver_type);
   m_solver->setUseWarmStart(useWarmStart);
+  m_direction_solver = Solver_LP_abstract::getNewSolver(solver_type);
+  m_direction_solver->setUseWarmStart(useWarmStart);
 
+  m_polytope_cache = NULL;
+  m_frictionCoefficient = -1.0;
+  m_coneTemplateFriction = -1.0;
   m_generatorsPerContact = generatorsPerContact;
   m_mass = mass;
   m_gravity.setZero();
@@ -48,35 +53,145 @@ StaticEquilibrium::StaticEquilibrium(string name, double mass, unsigned int gene
   m_D.block<3,3>(3,0) = crossMatrix(-m_mass*m_gravity);
 }
 
+StaticEquilibrium::~StaticEquilibrium()
+{
+  delete m_solver;
+  delete m_direction_solver;
+  for(size_t i=0; i<m_batch_solvers.size(); i++)
+    delete m_batch_solvers[i];
+}
+
+void StaticEquilibrium::useWarmStart(bool uws)
+{
+  m_solver->setUseWarmStart(uws);
+  m_direction_solver->setUseWarmStart(uws);
+  for(size_t i=0; i<m_batch_solvers.size(); i++)
+    m_batch_solvers[i]->setUseWarmStart(uws);
+}
+
+void StaticEquilibrium::clearWarmStartData()
+{
+  m_solver->clearWarmStartData();
+  m_direction_solver->clearWarmStartData();
+  for(size_t i=0; i<m_batch_solvers.size(); i++)
+    m_batch_solvers[i]->clearWarmStartData();
+}
+
 bool StaticEquilibrium::setNewContacts(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals,
                                        double frictionCoefficient, StaticEquilibriumAlgorithm alg)
 {
   assert(contactPoints.rows()==contactNormals.rows());
 
-  if(alg==STATIC_EQUILIBRIUM_ALGORITHM_IP)
+  m_algorithm = alg;
+
+  long int c = contactPoints.rows();
+  unsigned int &cg = m_generatorsPerContact;
+  m_G_centr.resize(6,c*cg);
+  if(!computeContactGenerators(contactPoints, contactNormals, frictionCoefficient, m_G_centr))
+    return false;
+  m_contactPoints = contactPoints;
+  m_contactNormals = contactNormals;
+  m_frictionCoefficient = frictionCoefficient;
+
+  if(c>0)
+  {
+    // Compute the coefficient to convert b0 to e_max
+    // (the first 3 rows of the generators are minus the contact generators)
+    Vector3 f0 = m_G_centr.block(0,0,3,cg).rowwise().sum(); // sum of the contact generators
+    Vector3 g0 = m_G_centr.block<3,1>(0,0);
+    // Compute the distance between the friction cone boundaries and
+    // the sum of the contact generators, which is e_max when b0=1.
+    // When b0!=1 we just multiply b0 times this value.
+    // This value depends only on the number of generators and the friction coefficient
+    m_b0_to_emax_coefficient = (f0.cross(g0)).norm();
+  }
+
+  return setupAlgorithm();
+}
+
+bool StaticEquilibrium::addContacts(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals)
+{
+  assert(contactPoints.rows()==contactNormals.rows());
+  if(m_frictionCoefficient<0.0)
   {
-    SEND_ERROR_MSG("Algorithm IP not implemented yet");
+    SEND_ERROR_MSG("setNewContacts must be called before addContacts");
     return false;
   }
-  if(alg==STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+
+  const long c_old = m_contactPoints.rows();
+  const long c_new = contactPoints.rows();
+  const long cg = m_generatorsPerContact;
+  // compute the new generators first, so that nothing changes if the contacts are not valid
+  Matrix6X G_new(6, c_new*cg);
+  if(!computeContactGenerators(contactPoints, contactNormals, m_frictionCoefficient, G_new))
+    return false;
+
+  m_G_centr.conservativeResize(6, (c_old+c_new)*cg);
+  m_G_centr.rightCols(c_new*cg) = G_new;
+  m_contactPoints.conservativeResize(c_old+c_new, 3);
+  m_contactPoints.bottomRows(c_new) = contactPoints;
+  m_contactNormals.conservativeResize(c_old+c_new, 3);
+  m_contactNormals.bottomRows(c_new) = contactNormals;
+  if(c_old==0 && c_new>0)
   {
-    SEND_ERROR_MSG("Algorithm DIP not implemented yet");
+    Vector3 f0 = m_G_centr.block(0,0,3,cg).rowwise().sum();
+    Vector3 g0 = m_G_centr.block<3,1>(0,0);
+    m_b0_to_emax_coefficient = (f0.cross(g0)).norm();
+  }
+
+  return setupAlgorithm();
+}
+
+bool StaticEquilibrium::removeContacts(unsigned int firstContact, unsigned int numberOfContacts)
+{
+  const long c = m_contactPoints.rows();
+  if(m_frictionCoefficient<0.0 || (long)firstContact+(long)numberOfContacts>c)
+  {
+    SEND_ERROR_MSG("Cannot remove contacts "+toString(firstContact)+"-"+toString(firstContact+numberOfContacts)+
+                   ", there are only "+toString(c)+" contacts");
     return false;
   }
 
-  m_algorithm = alg;
+  // shift the following contacts to fill the gap, then shrink
+  const long cg = m_generatorsPerContact;
+  const long tail = c-firstContact-numberOfContacts;
+  m_G_centr.middleCols(firstContact*cg, tail*cg) = m_G_centr.rightCols(tail*cg).eval();
+  m_G_centr.conservativeResize(6, (c-numberOfContacts)*cg);
+  m_contactPoints.middleRows(firstContact, tail) = m_contactPoints.bottomRows(tail).eval();
+  m_contactPoints.conservativeResize(c-numberOfContacts, 3);
+  m_contactNormals.middleRows(firstContact, tail) = m_contactNormals.bottomRows(tail).eval();
+  m_contactNormals.conservativeResize(c-numberOfContacts, 3);
+
+  return setupAlgorithm();
+}
 
+bool StaticEquilibrium::computeContactGenerators(Cref_matrixX3 contactPoints, Cref_matrixX3 contactNormals,
+                                                 double frictionCoefficient, Ref_matrix6X G_centr)
+{
   long int c = contactPoints.rows();
   unsigned int &cg = m_generatorsPerContact;
-  double theta, delta_theta=2*M_PI/cg;
+
+  // The generators of the friction cone expressed in the contact frame (T1, T2, normal) depend
+  // only on the number of generators and on the friction coefficient, so they are computed once.
+  // Since T1, T2 and the normal are orthonormal, all the generators have the same norm.
+  if(m_coneTemplate.cols()!=cg || m_coneTemplateFriction!=frictionCoefficient)
+  {
+    m_coneTemplate.resize(3, cg);
+    double delta_theta=2*M_PI/cg;
+    double norm = sqrt(1.0 + frictionCoefficient*frictionCoefficient);
+    for(int j=0; j<cg; j++)
+    {
+      m_coneTemplate(0,j) = frictionCoefficient*sin(j*delta_theta)/norm;
+      m_coneTemplate(1,j) = frictionCoefficient*cos(j*delta_theta)/norm;
+      m_coneTemplate(2,j) = 1.0/norm;
+    }
+    m_coneTemplateFriction = frictionCoefficient;
+  }
+
   // Tangent directions
   Vector3 T1, T2;
-  // Matrix mapping a 3d contact force to gravito-inertial wrench (6 X 3)
-  Matrix63 A;
-  A.topRows<3>() = -Matrix3::Identity();
-  // Lists of contact generators (3 X generatorsPerContact)
-  Matrix3X G(3, cg);
-  m_G_centr.resize(6,c*cg);
+  // Rotation from contact frame to world frame, with columns T1, T2 and the contact normal
+  Matrix3 R;
 
   for(long int i=0; i<c; i++)
   {
@@ -91,49 +206,490 @@ bool StaticEquilibrium::setNewContacts(Cref_matrixX3 contactPoints, Cref_matrixX
     if(T1.norm()<1e-5)
       T1 = contactNormals.row(i).cross(Vector3::UnitX());
     T2 = contactNormals.row(i).transpose().cross(T1);
-    T1.normalize();
-    T2.normalize();
+    R.col(0) = T1.normalized();
+    R.col(1) = T2.normalized();
+    R.col(2) = contactNormals.row(i).transpose();
 
-    // compute matrix mapping contact forces to gravito-inertial wrench
-    A.bottomRows<3>() = crossMatrix(-1.0*contactPoints.row(i).transpose());
+    // project generators in 6d centroidal space: the first 3 rows are minus the contact generators,
+    // the last 3 rows are the cross product of the contact point with the first 3 rows
+    // (each row of G_centr is contiguous, so these are vectorized operations on cg elements)
+    G_centr.block(0,cg*i,3,cg).noalias() = -R * m_coneTemplate;
+    const value_type px = contactPoints(i,0), py = contactPoints(i,1), pz = contactPoints(i,2);
+    G_centr.block(3,cg*i,1,cg) = py*G_centr.block(2,cg*i,1,cg) - pz*G_centr.block(1,cg*i,1,cg);
+    G_centr.block(4,cg*i,1,cg) = pz*G_centr.block(0,cg*i,1,cg) - px*G_centr.block(2,cg*i,1,cg);
+    G_centr.block(5,cg*i,1,cg) = px*G_centr.block(1,cg*i,1,cg) - py*G_centr.block(0,cg*i,1,cg);
+  }
+  return true;
+}
 
-    // compute generators
-    theta = 0.0;
-    for(int j=0; j<cg; j++)
+bool StaticEquilibrium::setupAlgorithm()
+{
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    PolytopeCache::Key key;
+    if(m_polytope_cache!=NULL)
     {
-      G.col(j) = frictionCoefficient*sin(theta)*T1
-                + frictionCoefficient*cos(theta)*T2
-                + contactNormals.row(i).transpose();
-      G.col(j).normalize();
-//      SEND_DEBUG_MSG("Contact "+toString(i)+" generator "+toString(j)+" = "+toString(G.col(j).transpose()));
-      theta += delta_theta;
+      key = m_polytope_cache->computeKey(m_contactPoints, m_contactNormals, m_frictionCoefficient,
+                                         m_generatorsPerContact, m_mass);
+      PolytopeCache::Entry entry;
+      if(m_polytope_cache->find(key, entry))
+      {
+        m_H.swap(entry.H);
+        m_h.swap(entry.h);
+        m_HD.swap(entry.HD);
+        m_Hd.swap(entry.Hd);
+        m_HG1.swap(entry.HG1);
+        return true;
+      }
     }
 
-    // project generators in 6d centroidal space
-    m_G_centr.block(0,cg*i,6,cg) = A * G;
+    if(!computePolytopeProjection(m_G_centr))
+      return false;
+    // normalize the rows of H so that H w is the signed distance of w from each face of the cone
+    for(long i=0; i<m_H.rows(); i++)
+    {
+      double norm = m_H.row(i).norm();
+      if(norm>1e-10)
+      {
+        m_H.row(i) /= norm;
+        m_h(i) /= norm;
+      }
+    }
+    m_HD = m_H * m_D;
+    m_Hd = m_H * m_d;
+    m_HG1 = m_H * m_G_centr.rowwise().sum();
+
+    if(m_polytope_cache!=NULL)
+    {
+      PolytopeCache::Entry entry;
+      entry.H = m_H;
+      entry.h = m_h;
+      entry.HD = m_HD;
+      entry.Hd = m_Hd;
+      entry.HG1 = m_HG1;
+      m_polytope_cache->insert(key, entry);
+    }
+  }
+  else if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_IP || m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+  {
+    setupDirectionLp();
+    if(!computeIncrementalProjection())
+      return false;
+    m_HG1.setZero(m_HD.rows());
+    // the incremental projection does not compute the wrench cone
+    m_H.resize(0,0);
+    m_h.resize(0);
+  }
+  else
+  {
+    setupRobustnessLp();
+    setupDirectionLp();
+    // the LP-based algorithms use neither the wrench cone nor the support polygon, so the ones
+    // computed for previous contacts or algorithms are cleared
+    m_H.resize(0,0);
+    m_h.resize(0);
+    m_HD.resize(0,3);
+    m_Hd.resize(0);
+    m_HG1.resize(0);
   }
 
-  // Compute the coefficient to convert b0 to e_max
-  Vector3 f0 = Vector3::Zero();
-  for(int j=0; j<cg; j++)
-    f0 += G.col(j); // sum of the contact generators
-  // Compute the distance between the friction cone boundaries and
-  // the sum of the contact generators, which is e_max when b0=1.
-  // When b0!=1 we just multiply b0 times this value.
-  // This value depends only on the number of generators and the friction coefficient
-  m_b0_to_emax_coefficient = (f0.cross(G.col(0))).norm();
+  return true;
+}
+
+/** Version of the format of the contact states saved by saveContactState */
+#define CONTACT_STATE_VERSION 1
 
-  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+namespace
+{
+  /** Read a matrix with the specified number of rows or columns (if positive) from the archive */
+  template<class Matrix>
+  bool readMatrix(const MatrixArchive& archive, const string& name, long rows, long cols, Matrix& matrix)
   {
-    if(!computePolytopeProjection(m_G_centr))
+    MatrixArchive::MatrixView view(NULL, 0, 0);
+    if(!archive.getMatrix(name, view) || (rows>=0 && view.rows()!=rows) || (cols>=0 && view.cols()!=cols))
       return false;
-    m_HD = m_H * m_D;
-    m_Hd = m_H * m_d;
+    matrix = view.template cast<typename Matrix::Scalar>();
+    return true;
   }
+}
 
+bool StaticEquilibrium::saveContactState(MatrixArchiveWriter& writer, const string& name)
+{
+  if(m_G_centr.cols()==0)
+  {
+    SEND_ERROR_MSG("Contacts have not been set, there is no contact state to save");
+    return false;
+  }
+  VectorX info(6);
+  info << CONTACT_STATE_VERSION, m_algorithm, m_generatorsPerContact, m_mass, m_b0_to_emax_coefficient,
+          m_frictionCoefficient;
+  return writer.addMatrix(name+"/info", info) &&
+         writer.addMatrix(name+"/contactPoints", m_contactPoints) &&
+         writer.addMatrix(name+"/contactNormals", m_contactNormals) &&
+         writer.addMatrix(name+"/G_centr", m_G_centr) &&
+         writer.addMatrix(name+"/H", m_H) &&
+         writer.addMatrix(name+"/h", m_h) &&
+         writer.addMatrix(name+"/HD", m_HD) &&
+         writer.addMatrix(name+"/Hd", m_Hd) &&
+         writer.addMatrix(name+"/HG1", m_HG1);
+}
+
+bool StaticEquilibrium::loadContactState(const MatrixArchive& archive, const string& name)
+{
+  VectorX info;
+  if(!readMatrix(archive, name+"/info", 6, 1, info) || info(0)!=CONTACT_STATE_VERSION)
+  {
+    SEND_ERROR_MSG("Archive does not contain a valid contact state named "+name);
+    return false;
+  }
+  if(info(2)!=m_generatorsPerContact || info(3)!=m_mass)
+  {
+    SEND_ERROR_MSG("Contact state "+name+" has been computed with "+toString(info(2))+
+                   " generators per contact and mass "+toString(info(3))+", while "+m_name+" has "+
+                   toString(m_generatorsPerContact)+" generators per contact and mass "+toString(m_mass));
+    return false;
+  }
+  Matrix6X G_centr;
+  MatrixXX H;
+  MatrixX3 HD, contactPoints, contactNormals;
+  VectorX h, Hd, HG1;
+  bool ok = readMatrix(archive, name+"/contactPoints", -1, 3, contactPoints) &&
+            readMatrix(archive, name+"/contactNormals", contactPoints.rows(), 3, contactNormals) &&
+            readMatrix(archive, name+"/G_centr", 6, contactPoints.rows()*m_generatorsPerContact, G_centr) &&
+            readMatrix(archive, name+"/H", -1, -1, H) &&
+            readMatrix(archive, name+"/h", H.rows(), 1, h) &&
+            readMatrix(archive, name+"/HD", -1, 3, HD) &&
+            readMatrix(archive, name+"/Hd", HD.rows(), 1, Hd) &&
+            readMatrix(archive, name+"/HG1", -1, 1, HG1) &&
+            info(1)>=STATIC_EQUILIBRIUM_ALGORITHM_LP && info(1)<=STATIC_EQUILIBRIUM_ALGORITHM_DIP;
+  if(ok)
+  {
+    // the wrench cone (PP only) and the support polygon (PP, IP and DIP) must be consistent
+    // and non-empty, because checkRobustEquilibrium reads HD, Hd and HG1 row by row
+    const StaticEquilibriumAlgorithm alg = (StaticEquilibriumAlgorithm)(int) info(1);
+    if(alg==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+      ok = H.rows()>0 && H.cols()==6 && HD.rows()==H.rows() && HG1.size()==HD.rows();
+    else if(alg==STATIC_EQUILIBRIUM_ALGORITHM_IP || alg==STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+      ok = HD.rows()>0 && HG1.size()==HD.rows();
+  }
+  if(!ok)
+  {
+    SEND_ERROR_MSG("Contact state "+name+" is not valid");
+    return false;
+  }
+
+  m_algorithm = (StaticEquilibriumAlgorithm)(int) info(1);
+  m_b0_to_emax_coefficient = info(4);
+  m_frictionCoefficient = info(5);
+  m_contactPoints.swap(contactPoints);
+  m_contactNormals.swap(contactNormals);
+  m_G_centr.swap(G_centr);
+  m_H.swap(H);
+  m_h.swap(h);
+  m_HD.swap(HD);
+  m_Hd.swap(Hd);
+  m_HG1.swap(HG1);
+
+  // the matrices not used by the algorithm are cleared as in setupAlgorithm, also if the state
+  // has been saved with the data of a previous stance
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_IP || m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+  {
+    m_H.resize(0,0);
+    m_h.resize(0);
+    setupDirectionLp();
+  }
+  else if(m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    m_H.resize(0,0);
+    m_h.resize(0);
+    m_HD.resize(0,3);
+    m_Hd.resize(0);
+    m_HG1.resize(0);
+    setupRobustnessLp();
+    setupDirectionLp();
+  }
   return true;
 }
 
+void StaticEquilibrium::setupRobustnessLp()
+{
+  const long m = m_G_centr.cols(); // number of gravito-inertial wrench generators
+  LP_data &lp = m_robustness_lp;
+
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_LP)
+  {
+    // see computeEquilibriumRobustness for the LP formulation
+    lp.x.resize(m+1);
+    lp.c.setZero(m+1);
+    lp.c(m) = -1.0;
+    lp.lb = -VectorX::Ones(m+1)*1e5;
+    lp.ub = VectorX::Ones(m+1)*1e10;
+    lp.Alb.setZero(6+m);
+    lp.Aub = VectorX::Ones(6+m)*1e100;
+    lp.A.setZero(6+m, m+1);
+    lp.A.topLeftCorner(6,m)      = m_G_centr;
+    lp.A.bottomLeftCorner(m,m)   = MatrixXX::Identity(m,m);
+    lp.A.bottomRightCorner(m,1)  = -VectorX::Ones(m);
+  }
+  else if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_LP2)
+  {
+    // see computeEquilibriumRobustness for the LP formulation
+    lp.x.resize(m+1);
+    lp.c.setZero(m+1);
+    lp.c(m) = -1.0;
+    lp.lb.setZero(m+1);
+    lp.lb(m) = -1e10;
+    lp.ub = VectorX::Ones(m+1)*1e10;
+    lp.Alb.setZero(6);
+    lp.Aub.setZero(6);
+    lp.A.resize(6, m+1);
+    lp.A.leftCols(m)  = m_G_centr;
+    lp.A.rightCols(1) = m_G_centr * VectorX::Ones(m);
+  }
+  else if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_DLP)
+  {
+    // see computeEquilibriumRobustness for the dual LP formulation
+    lp.x.resize(6);
+    lp.c.setZero(6);
+    lp.lb = VectorX::Ones(6)*-1e100;
+    lp.ub = VectorX::Ones(6)*1e100;
+    lp.Alb.setZero(m+1);
+    lp.Alb(m) = 1.0;
+    lp.Aub = VectorX::Ones(m+1)*1e100;
+    lp.Aub(m) = 1.0;
+    lp.A.resize(m+1, 6);
+    lp.A.topRows(m) = m_G_centr.transpose();
+    lp.A.bottomRows(1) = (m_G_centr*VectorX::Ones(m)).transpose();
+  }
+}
+
+
+void StaticEquilibrium::setupDirectionLp()
+{
+  const long m = m_G_centr.cols(); // number of gravito-inertial wrench generators
+  LP_data &lp = m_direction_lp;
+
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_DLP || m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+  {
+    /* Dual LP formulation:
+          find          v
+          minimize      (d - G 1 b0)' v
+          subject to    0  <= G' v  <= Inf
+                        -a <= D' v  <= -a
+        where
+          G         is the matrix whose columns are the gravito-inertial wrench generators
+          D         are the first 2 columns of the matrix mapping the com position to the GIW
+          a         is the 2d direction
+        The optimal com position is minus the dual solution associated to the last two constraints.
+    */
+    lp.x.resize(6);
+    lp.y.resize(m+2);
+    lp.c = m_d;
+    lp.lb = -VectorX::Ones(6)*1e10;
+    lp.ub = VectorX::Ones(6)*1e10;
+    lp.Alb.setZero(m+2);
+    lp.Aub = VectorX::Ones(m+2)*1e10;
+    lp.A.resize(m+2, 6);
+    lp.A.topRows(m) = m_G_centr.transpose();
+    lp.A.bottomRows(2) = m_D.leftCols<2>().transpose();
+  }
+  else
+  {
+    /* Primal LP formulation:
+          find          b, c
+          minimize      -a' c
+          subject to    d  <= G b - D c <= d
+                        b0 <= b         <= Inf
+        where
+          b         are the coefficient of the contact force generators (f = G b)
+          c         is the 2d com position
+          G         is the matrix whose columns are the gravito-inertial wrench generators
+          D         are the first 2 columns of the matrix mapping the com position to the GIW
+          a         is the 2d direction
+    */
+    lp.x.resize(m+2);
+    lp.y.resize(6);
+    lp.c.setZero(m+2);
+    lp.lb.setZero(m+2);
+    lp.lb.tail<2>().setConstant(-1e10);
+    lp.ub = VectorX::Ones(m+2)*1e10;
+    lp.Alb = m_d;
+    lp.Aub = m_d;
+    lp.A.resize(6, m+2);
+    lp.A.leftCols(m)  = m_G_centr;
+    lp.A.rightCols<2>() = -m_D.leftCols<2>();
+  }
+}
+
+LP_status StaticEquilibrium::solveDirectionLp(Cref_vector2 a, double b0, Ref_vector2 com)
+{
+  const long m = m_G_centr.cols(); // number of gravito-inertial wrench generators
+  LP_data &lp = m_direction_lp;
+
+  if(lp.x.size()==6)
+  {
+    lp.c.head<6>() = m_d - m_G_centr.rowwise().sum()*b0;
+    lp.Alb.tail<2>() = -a;
+    lp.Aub.tail<2>() = -a;
+
+    LP_status lpStatus_dual = m_direction_solver->solve(lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub, lp.x);
+    if(lpStatus_dual==LP_STATUS_OPTIMAL)
+    {
+      // since QP oases cannot detect unboundedness we check here whether the objective value is a large negative value
+      if(m_direction_solver->getObjectiveValue()<-1e7)
+        return LP_STATUS_INFEASIBLE;
+      m_direction_solver->getDualSolution(lp.y);
+      com = -lp.y.tail<2>();
+      return lpStatus_dual;
+    }
+
+    // switch UNFEASIBLE and UNBOUNDED flags because we are solving dual problem
+    if(lpStatus_dual==LP_STATUS_INFEASIBLE)
+      lpStatus_dual = LP_STATUS_UNBOUNDED;
+    else if(lpStatus_dual==LP_STATUS_UNBOUNDED)
+      lpStatus_dual = LP_STATUS_INFEASIBLE;
+    return lpStatus_dual;
+  }
+
+  lp.c.tail<2>() = -a;
+  lp.lb.head(m).setConstant(b0);
+  LP_status lpStatus_primal = m_direction_solver->solve(lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub, lp.x);
+  if(lpStatus_primal==LP_STATUS_OPTIMAL)
+  {
+    // the com is bounded by +-1e10, so an unbounded support polygon results in a com
+    // position on these bounds rather than in an unbounded LP
+    if(lp.x.tail<2>().cwiseAbs().maxCoeff()>=1e9)
+      return LP_STATUS_UNBOUNDED;
+    com = lp.x.tail<2>();
+  }
+  return lpStatus_primal;
+}
+
+bool StaticEquilibrium::computeIncrementalProjection()
+{
+  const double TOLERANCE = 1e-4;  // max distance [m] between the computed polygon and the real one
+  const int MAX_LP_NUMBER = 1000; // max number of LPs to solve
+  const int N_DIRECTIONS_DEGENERATE = 16;
+
+  typedef std::vector<Vector2, Eigen::aligned_allocator<Vector2> > VertexList;
+  VertexList vertices;      // vertices of the inner approximation, counterclockwise
+  std::vector<bool> done;   // done[i] is true if edge (i,i+1) is an edge of the support polygon
+  Vector2 a, p;
+  LP_status status;
+  int nLps = 0;
+
+  // initialize the inner approximation with the extremum points in 3 directions
+  for(int k=0; k<3; k++)
+  {
+    a << cos(2*M_PI*k/3), sin(2*M_PI*k/3);
+    status = solveDirectionLp(a, 0.0, p);
+    nLps++;
+    if(status==LP_STATUS_INFEASIBLE)
+    {
+      // no com position is in equilibrium: use a constraint that can never be satisfied
+      m_HD.setZero(1,3);
+      m_Hd.setOnes(1);
+      return true;
+    }
+    if(status==LP_STATUS_UNBOUNDED)
+    {
+      SEND_ERROR_MSG("The support polygon is unbounded, incremental projection cannot represent it");
+      return false;
+    }
+    if(status!=LP_STATUS_OPTIMAL)
+    {
+      SEND_ERROR_MSG("LP of incremental projection could not be solved: "+toString(status));
+      return false;
+    }
+    vertices.push_back(p);
+  }
+
+  Vector2 e1 = vertices[1]-vertices[0], e2 = vertices[2]-vertices[0];
+  if(e1(0)*e2(1)-e1(1)*e2(0) < TOLERANCE*TOLERANCE)
+  {
+    // the support polygon has (almost) no area: use an outer approximation
+    SEND_WARNING_MSG("The support polygon is degenerate, using an outer approximation");
+    m_HD.setZero(N_DIRECTIONS_DEGENERATE,3);
+    m_Hd.resize(N_DIRECTIONS_DEGENERATE);
+    for(int k=0; k<N_DIRECTIONS_DEGENERATE; k++)
+    {
+      a << cos(2*M_PI*k/N_DIRECTIONS_DEGENERATE), sin(2*M_PI*k/N_DIRECTIONS_DEGENERATE);
+      status = solveDirectionLp(a, 0.0, p);
+      if(status!=LP_STATUS_OPTIMAL)
+      {
+        SEND_ERROR_MSG("LP of incremental projection could not be solved: "+toString(status));
+        return false;
+      }
+      m_HD.block<1,2>(k,0) = a.transpose();
+      m_Hd(k) = -a.dot(p);
+    }
+    return true;
+  }
+
+  // expand the inner approximation until all its edges belong to the support polygon
+  done.assign(3, false);
+  size_t i = 0;
+  while(true)
+  {
+    for(i=0; i<done.size() && done[i]; i++);
+    if(i==done.size())
+      break;
+    if(nLps>=MAX_LP_NUMBER)
+    {
+      SEND_WARNING_MSG("Incremental projection reached the maximum number of LPs, using inner approximation");
+      break;
+    }
+
+    // outward normal of edge (i,i+1)
+    const Vector2 &v1 = vertices[i];
+    const Vector2 &v2 = vertices[(i+1)%vertices.size()];
+    a << v2(1)-v1(1), v1(0)-v2(0);
+    if(a.norm()<TOLERANCE)
+    {
+      done[i] = true;
+      continue;
+    }
+    a.normalize();
+
+    status = solveDirectionLp(a, 0.0, p);
+    nLps++;
+    if(status!=LP_STATUS_OPTIMAL)
+    {
+      SEND_ERROR_MSG("LP of incremental projection could not be solved: "+toString(status));
+      return false;
+    }
+
+    if(a.dot(p-v1) <= TOLERANCE)
+      done[i] = true;
+    else
+    {
+      vertices.insert(vertices.begin()+i+1, p);
+      done.insert(done.begin()+i+1, false);
+    }
+  }
+
+  // convert the polygon edges into inequalities with normalized rows
+  long nEdges = 0;
+  for(i=0; i<vertices.size(); i++)
+    if((vertices[(i+1)%vertices.size()]-vertices[i]).norm()>=TOLERANCE)
+      nEdges++;
+  m_HD.setZero(nEdges,3);
+  m_Hd.resize(nEdges);
+  long j = 0;
+  for(i=0; i<vertices.size(); i++)
+  {
+    const Vector2 &v1 = vertices[i];
+    const Vector2 &v2 = vertices[(i+1)%vertices.size()];
+    if((v2-v1).norm()<TOLERANCE)
+      continue;
+    a << v2(1)-v1(1), v1(0)-v2(0);
+    a.normalize();
+    m_HD.block<1,2>(j,0) = a.transpose();
+    m_Hd(j) = -a.dot(v1);
+    j++;
+  }
+  return true;
+}
 
 LP_status StaticEquilibrium::computeEquilibriumRobustness(Cref_vector3 com, double &robustness)
 {
@@ -141,6 +697,243 @@ LP_status StaticEquilibrium::computeEquilibriumRobustness(Cref_vector3 com, doub
   if(m==0)
     return LP_STATUS_INFEASIBLE;
 
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    /* The robustness is the signed distance of the gravito-inertial wrench w = D c + d
+     * from the boundary of the cone H w <= 0, whose rows have been normalized:
+     *    robustness = - max_i (HD_i c + Hd_i)
+     */
+    if(m_HD.rows()==0)
+      return LP_STATUS_UNBOUNDED;
+    robustness = -(m_HD.row(0).dot(com) + m_Hd(0));
+    for(long i=1; i<m_HD.rows(); i++)
+      robustness = std::min<double>(robustness, -(m_HD.row(i).dot(com) + m_Hd(i)));
+    return LP_STATUS_OPTIMAL;
+  }
+
+  return solveRobustnessLp(com, m_solver, m_robustness_lp, robustness);
+}
+
+bool StaticEquilibrium::computeEquilibriumRobustness(Cref_matrixX3 coms, Ref_vectorX robustness,
+                                                     std::vector<LP_status> &status, unsigned int nThreads)
+{
+  const long N = coms.rows();
+  assert(robustness.size()==N);
+  status.resize(N);
+  if(N==0)
+    return true;
+
+  if(m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_LP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_LP2 &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_DLP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    SEND_ERROR_MSG("computeEquilibriumRobustness is not implemented for the specified algorithm");
+    return false;
+  }
+
+  if(m_G_centr.cols()==0)
+  {
+    std::fill(status.begin(), status.end(), LP_STATUS_INFEASIBLE);
+    return true;
+  }
+
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    // a single matrix product gives the distances from all the faces for all the com positions
+    if(m_HD.rows()==0)
+    {
+      std::fill(status.begin(), status.end(), LP_STATUS_UNBOUNDED);
+      return true;
+    }
+    MatrixXX res = coms * m_HD.transpose();
+    res.rowwise() += m_Hd.transpose();
+    robustness = -res.rowwise().maxCoeff();
+    std::fill(status.begin(), status.end(), LP_STATUS_OPTIMAL);
+    return true;
+  }
+
+  if(nThreads==0)
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  if(nThreads>N)
+    nThreads = (unsigned int)N;
+
+  while(m_batch_solvers.size()<nThreads)
+  {
+    Solver_LP_abstract* solver = Solver_LP_abstract::getNewSolver(m_solver_type);
+    solver->setUseWarmStart(m_solver->getUseWarmStart());
+    m_batch_solvers.push_back(solver);
+  }
+
+  // each worker gets a contiguous block of com positions and its own copy of the LP,
+  // so that consecutive LPs solved by the same solver are similar to each other
+  std::vector<LP_data> lps(nThreads, m_robustness_lp);
+  std::vector<std::thread> workers;
+  const long blockSize = (N + nThreads - 1) / nThreads;
+  for(unsigned int t=0; t<nThreads; t++)
+  {
+    const long first = t*blockSize;
+    const long last = std::min(N, first+blockSize);
+    workers.push_back(std::thread([this, &coms, &robustness, &status, &lps, first, last, t]()
+    {
+      double rob;
+      for(long i=first; i<last; i++)
+      {
+        rob = 0.0;
+        status[i] = solveRobustnessLp(coms.row(i), m_batch_solvers[t], lps[t], rob);
+        robustness(i) = rob;
+      }
+    }));
+  }
+  for(unsigned int t=0; t<nThreads; t++)
+    workers[t].join();
+
+  return true;
+}
+
+bool StaticEquilibrium::computeRobustnessMap(const RobustnessGrid& grid, Ref_vectorX robustness,
+                                             std::vector<LP_status> &status, unsigned int nThreads)
+{
+  const long N = grid.size();
+  assert(robustness.size()==N);
+  status.resize(N);
+  if(N==0)
+    return true;
+
+  if(m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_LP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_LP2 &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_DLP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    SEND_ERROR_MSG("computeRobustnessMap is not implemented for the specified algorithm");
+    return false;
+  }
+
+  if(m_G_centr.cols()==0)
+  {
+    std::fill(status.begin(), status.end(), LP_STATUS_INFEASIBLE);
+    return true;
+  }
+
+  const long layerSize = (long)grid.nx*grid.ny;
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    MatrixX3 coms(layerSize, 3);
+    for(unsigned int j=0; j<grid.ny; j++)
+      for(unsigned int i=0; i<grid.nx; i++)
+        coms.row(grid.index(i,j)) << grid.origin(0)+i*grid.step(0), grid.origin(1)+j*grid.step(1), grid.origin(2);
+    std::vector<LP_status> layerStatus;
+    computeEquilibriumRobustness(coms, robustness.head(layerSize), layerStatus);
+    std::copy(layerStatus.begin(), layerStatus.end(), status.begin());
+  }
+  else
+  {
+    if(nThreads==0)
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+    if(nThreads>grid.ny)
+      nThreads = grid.ny;
+
+    while(m_batch_solvers.size()<nThreads)
+    {
+      Solver_LP_abstract* solver = Solver_LP_abstract::getNewSolver(m_solver_type);
+      solver->setUseWarmStart(m_solver->getUseWarmStart());
+      m_batch_solvers.push_back(solver);
+    }
+
+    // each worker gets a contiguous block of rows, which it scans in serpentine order,
+    // so that the last cell of a row is next to the first cell of the following one
+    std::vector<LP_data> lps(nThreads, m_robustness_lp);
+    std::vector<std::thread> workers;
+    const unsigned int blockSize = (grid.ny + nThreads - 1) / nThreads;
+    for(unsigned int t=0; t<nThreads; t++)
+    {
+      const unsigned int first = t*blockSize;
+      const unsigned int last = std::min(grid.ny, first+blockSize);
+      workers.push_back(std::thread([this, &grid, &robustness, &status, &lps, first, last, t]()
+      {
+        for(unsigned int j=first; j<last; j++)
+          computeRobustnessRow(grid, j, (j-first)%2==1, m_batch_solvers[t], lps[t],
+                               &robustness(grid.index(0,j)), &status[grid.index(0,j)]);
+      }));
+    }
+    for(unsigned int t=0; t<nThreads; t++)
+      workers[t].join();
+  }
+
+  // the robustness does not depend on the com height
+  for(unsigned int k=1; k<grid.nz; k++)
+  {
+    robustness.segment(k*layerSize, layerSize) = robustness.head(layerSize);
+    std::copy(status.begin(), status.begin()+layerSize, status.begin()+k*layerSize);
+  }
+  return true;
+}
+
+void StaticEquilibrium::computeRobustnessRow(const RobustnessGrid& grid, unsigned int j, bool reverse,
+                                             Solver_LP_abstract* solver, LP_data &lp,
+                                             value_type* robustness, LP_status* status)
+{
+  // cells are addressed by their position s in the scan, which is cell s or nx-1-s of the row
+  const long n = grid.nx;
+  std::vector<bool> solved(n, false);
+  Vector3 com;
+  com(1) = grid.origin(1) + j*grid.step(1);
+  com(2) = grid.origin(2);
+  auto cell = [n, reverse](long s){ return reverse ? n-1-s : s; };
+  auto solve = [&](long s)
+  {
+    const long i = cell(s);
+    if(!solved[i])
+    {
+      double rob = 0.0;
+      com(0) = grid.origin(0) + i*grid.step(0);
+      status[i] = solveRobustnessLp(com, solver, lp, rob);
+      robustness[i] = rob;
+      solved[i] = true;
+    }
+    return status[i]==LP_STATUS_OPTIMAL;
+  };
+
+  solve(0);
+  if(n==1)
+    return;
+  solve(1);
+
+  /* If the robustness r of cells cur-1, cur and target is aligned, the concave function r
+   * is linear on [cur-1, target]. Each time this happens the distance of the next target
+   * is doubled, otherwise the scan goes back to the next cell. A target that is not
+   * aligned is not wasted, because it is solved only once when the scan reaches it. */
+  long cur = 1, step = 2;
+  while(cur<n-1)
+  {
+    const long target = std::min(cur+step, n-1);
+    if(grid.tolerance>=0.0 && target>cur+1 &&
+       status[cell(cur-1)]==LP_STATUS_OPTIMAL && status[cell(cur)]==LP_STATUS_OPTIMAL && solve(target))
+    {
+      const double slope = robustness[cell(cur)] - robustness[cell(cur-1)];
+      if(fabs(robustness[cell(target)] - robustness[cell(cur)] - slope*(target-cur)) <= grid.tolerance)
+      {
+        for(long s=cur+1; s<target; s++)
+        {
+          if(solved[cell(s)])
+            continue;
+          robustness[cell(s)] = robustness[cell(cur)] + slope*(s-cur);
+          status[cell(s)] = LP_STATUS_OPTIMAL;
+        }
+        cur = target;
+        step *= 2;
+        continue;
+      }
+      step = 2;
+    }
+    solve(cur+1);
+    cur++;
+  }
+}
+
+LP_status StaticEquilibrium::solveRobustnessLp(Cref_vector3 com, Solver_LP_abstract* solver,
+                                                LP_data &lp, double &robustness)
+{
   if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_LP)
   {
     /* Compute the robustness measure of the equilibrium of a specified CoM position
@@ -155,24 +948,13 @@ LP_status StaticEquilibrium::computeEquilibriumRobustness(Cref_vector3 com, doub
           c         is the CoM position
           G         is the matrix whose columns are the gravito-inertial wrench generators
     */
-    VectorX b_b0(m+1);
-    VectorX c = VectorX::Zero(m+1);
-    c(m) = -1.0;
-    VectorX lb = -VectorX::Ones(m+1)*1e5;
-    VectorX ub = VectorX::Ones(m+1)*1e10;
-    VectorX Alb = VectorX::Zero(6+m);
-    VectorX Aub = VectorX::Ones(6+m)*1e100;
-    MatrixXX A = MatrixXX::Zero(6+m, m+1);
-    Alb.head<6>() = m_D * com + m_d;
-    Aub.head<6>() = Alb.head<6>();
-    A.topLeftCorner(6,m)      = m_G_centr;
-    A.bottomLeftCorner(m,m)   = MatrixXX::Identity(m,m);
-    A.bottomRightCorner(m,1)  = -VectorX::Ones(m);
-
-    LP_status lpStatus = m_solver->solve(c, lb, ub, A, Alb, Aub, b_b0);
+    lp.Alb.head<6>() = m_D * com + m_d;
+    lp.Aub.head<6>() = lp.Alb.head<6>();
+
+    LP_status lpStatus = solver->solve(lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub, lp.x);
     if(lpStatus==LP_STATUS_OPTIMAL)
     {
-      robustness = convert_b0_to_emax(-1.0*m_solver->getObjectiveValue());
+      robustness = convert_b0_to_emax(-1.0*solver->getObjectiveValue());
       return lpStatus;
     }
 
@@ -194,22 +976,13 @@ LP_status StaticEquilibrium::computeEquilibriumRobustness(Cref_vector3 com, doub
             c         is the CoM position
             G         is the matrix whose columns are the gravito-inertial wrench generators
       */
-    VectorX b_b0(m+1);
-    VectorX c = VectorX::Zero(m+1);
-    c(m) = -1.0;
-    VectorX lb = VectorX::Zero(m+1);
-    lb(m) = -1e10;
-    VectorX ub = VectorX::Ones(m+1)*1e10;
-    MatrixXX A = MatrixXX::Zero(6, m+1);
-    Vector6 Alb = m_D * com + m_d;
-    Vector6 Aub = Alb;
-    A.leftCols(m)  = m_G_centr;
-    A.rightCols(1) = m_G_centr * VectorX::Ones(m);
+    lp.Alb.head<6>() = m_D * com + m_d;
+    lp.Aub.head<6>() = lp.Alb.head<6>();
 
-    LP_status lpStatus_primal = m_solver->solve(c, lb, ub, A, Alb, Aub, b_b0);
+    LP_status lpStatus_primal = solver->solve(lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub, lp.x);
     if(lpStatus_primal==LP_STATUS_OPTIMAL)
     {
-      robustness = convert_b0_to_emax(-1.0*m_solver->getObjectiveValue());
+      robustness = convert_b0_to_emax(-1.0*solver->getObjectiveValue());
       return lpStatus_primal;
     }
 
@@ -230,22 +1003,12 @@ LP_status StaticEquilibrium::computeEquilibriumRobustness(Cref_vector3 com, doub
         c             is the CoM position
         G             is the matrix whose columns are the gravito-inertial wrench generators
      */
-    Vector6 v;
-    Vector6 c = m_D*com + m_d;
-    Vector6 lb = Vector6::Ones()*-1e100;
-    Vector6 ub = Vector6::Ones()*1e100;
-    VectorX Alb = VectorX::Zero(m+1);
-    Alb(m) = 1.0;
-    VectorX Aub = VectorX::Ones(m+1)*1e100;
-    Aub(m) = 1.0;
-    MatrixX6 A(m+1,6);
-    A.topRows(m) = m_G_centr.transpose();
-    A.bottomRows<1>() = (m_G_centr*VectorX::Ones(m)).transpose();
+    lp.c.head<6>() = m_D*com + m_d;
 
-    LP_status lpStatus_dual = m_solver->solve(c, lb, ub, A, Alb, Aub, v);
+    LP_status lpStatus_dual = solver->solve(lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub, lp.x);
     if(lpStatus_dual==LP_STATUS_OPTIMAL)
     {
-      robustness = convert_b0_to_emax(m_solver->getObjectiveValue());
+      robustness = convert_b0_to_emax(solver->getObjectiveValue());
       return lpStatus_dual;
     }
     SEND_DEBUG_MSG("Dual LP problem for com position "+toString(com.transpose())+" could not be solved: "+toString(lpStatus_dual));
@@ -259,7 +1022,7 @@ LP_status StaticEquilibrium::computeEquilibriumRobustness(Cref_vector3 com, doub
     return lpStatus_dual;
   }
 
-  SEND_ERROR_MSG("checkRobustEquilibrium is not implemented for the specified algorithm");
+  SEND_ERROR_MSG("computeEquilibriumRobustness is not implemented for the specified algorithm");
   return LP_STATUS_ERROR;
 }
 
@@ -270,20 +1033,26 @@ LP_status StaticEquilibrium::checkRobustEquilibrium(Cref_vector3 com, bool &equi
     equilibrium=false;
     return LP_STATUS_OPTIMAL;
   }
-  if(e_max!=0.0)
+  if(m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_IP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_DIP)
   {
-    SEND_ERROR_MSG("checkRobustEquilibrium with e_max!=0 not implemented yet");
+    SEND_ERROR_MSG("checkRobustEquilibrium is only implemented for the PP, IP and DIP algorithms");
     return LP_STATUS_ERROR;
   }
-  if(m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  if(e_max!=0.0 && m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP)
   {
-    SEND_ERROR_MSG("checkRobustEquilibrium is only implemented for the PP algorithm");
+    SEND_ERROR_MSG("checkRobustEquilibrium with e_max!=0 is only implemented for the PP algorithm");
     return LP_STATUS_ERROR;
   }
 
-  VectorX res = m_HD * com + m_Hd;
-  for(long i=0; i<res.size(); i++)
-    if(res(i)>0.0)
+  /* The robust wrench cone is the wrench cone shifted by G 1 b0, so the robust support polygon is
+       HD com + Hd - H G 1 b0 <= 0
+  */
+  const double b0 = convert_emax_to_b0(e_max);
+
+  for(long i=0; i<m_HD.rows(); i++)
+    if(m_HD.row(i).dot(com) + m_Hd(i) - b0*m_HG1(i) > 0.0)
     {
       equilibrium = false;
       return LP_STATUS_OPTIMAL;
@@ -293,6 +1062,63 @@ LP_status StaticEquilibrium::checkRobustEquilibrium(Cref_vector3 com, bool &equi
   return LP_STATUS_OPTIMAL;
 }
 
+LP_status StaticEquilibrium::checkRobustEquilibrium(Cref_matrixX3 coms, std::vector<bool> &equilibrium, double e_max)
+{
+  const long N = coms.rows();
+  equilibrium.assign(N, false);
+  if(m_G_centr.cols()==0)
+    return LP_STATUS_OPTIMAL;
+  if(m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_IP &&
+     m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+  {
+    SEND_ERROR_MSG("checkRobustEquilibrium is only implemented for the PP, IP and DIP algorithms");
+    return LP_STATUS_ERROR;
+  }
+  if(e_max!=0.0 && m_algorithm!=STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    SEND_ERROR_MSG("checkRobustEquilibrium with e_max!=0 is only implemented for the PP algorithm");
+    return LP_STATUS_ERROR;
+  }
+
+  /* The robust wrench cone is the wrench cone shifted by G 1 b0, so the robust support polygon is
+       HD com + Hd - H G 1 b0 <= 0
+  */
+  const double b0 = convert_emax_to_b0(e_max);
+
+  // The com positions are processed in fixed-size blocks stored as structure of arrays,
+  // so that the test of each face of the polytope is vectorized over the whole block.
+  // Unused lanes of the last block are filled with a copy of its first com position.
+  const int BLOCK_SIZE = 32;
+  typedef Eigen::Array<value_type, 1, BLOCK_SIZE> BlockArray;
+  BlockArray x, y, z;
+  Eigen::Array<bool, 1, BLOCK_SIZE> inside;
+  for(long first=0; first<N; first+=BLOCK_SIZE)
+  {
+    const int n = (int)std::min<long>(BLOCK_SIZE, N-first);
+    for(int k=0; k<BLOCK_SIZE; k++)
+    {
+      const long j = (k<n) ? first+k : first;
+      x(k) = coms(j,0);
+      y(k) = coms(j,1);
+      z(k) = coms(j,2);
+    }
+
+    inside.setConstant(true);
+    for(long i=0; i<m_HD.rows(); i++)
+    {
+      inside = inside && (x*m_HD(i,0) + y*m_HD(i,1) + z*m_HD(i,2) + (m_Hd(i) - b0*m_HG1(i)) <= 0.0);
+      if(!inside.head(n).any())
+        break;  // all the com positions of this block are out of the polytope
+    }
+
+    for(int k=0; k<n; k++)
+      equilibrium[first+k] = inside(k);
+  }
+
+  return LP_STATUS_OPTIMAL;
+}
+
 LP_status StaticEquilibrium::findExtremumOverLine(Cref_vector3 a, Cref_vector3 a0, double e_max, Ref_vector3 com)
 {
   const long m = m_G_centr.cols(); // number of gravito-inertial wrench generators
@@ -427,30 +1253,60 @@ LP_status StaticEquilibrium::findExtremumInDirection(Cref_vector3 direction, Ref
 {
   if(m_G_centr.cols()==0)
     return LP_STATUS_INFEASIBLE;
-  SEND_ERROR_MSG("findExtremumInDirection not implemented yet");
-  return LP_STATUS_ERROR;
+  if(m_algorithm==STATIC_EQUILIBRIUM_ALGORITHM_PP)
+  {
+    SEND_ERROR_MSG("findExtremumInDirection is not implemented for the PP algorithm");
+    return LP_STATUS_ERROR;
+  }
+
+  // the equilibrium region does not depend on the com height, so it is unbounded along z
+  if(fabs(direction(2))>1e-10)
+    return LP_STATUS_UNBOUNDED;
+
+  // see setupDirectionLp for the primal (LP, LP2, IP) and dual (DLP, DIP) LP formulations
+  Vector2 com_xy;
+  LP_status status = solveDirectionLp(direction.head<2>(), convert_emax_to_b0(e_max), com_xy);
+  if(status==LP_STATUS_OPTIMAL)
+  {
+    com.head<2>() = com_xy;
+    com(2) = 0.0;
+    return status;
+  }
+
+  SEND_DEBUG_MSG("LP problem could not be solved suggesting that no equilibrium position with robustness "+
+                 toString(e_max)+" exists in direction "+toString(direction.transpose())+
+                 ", solver error code: "+toString(status));
+  return status;
 }
 
 bool StaticEquilibrium::computePolytopeProjection(Cref_matrix6X v)
 {
-//  getProfiler().start("eigen_to_cdd");
+  PROFILE_START("eigen_to_cdd");
   dd_MatrixPtr V = cone_span_eigen_to_cdd(v.transpose());
-//  getProfiler().stop("eigen_to_cdd");
+  PROFILE_STOP("eigen_to_cdd");
 
   dd_ErrorType error = dd_NoError;
-
-//  getProfiler().start("dd_DDMatrix2Poly");
-  dd_PolyhedraPtr H_= dd_DDMatrix2Poly(V, &error);
-//  getProfiler().stop("dd_DDMatrix2Poly");
-
-  if(error != dd_NoError)
+  dd_PolyhedraPtr H_;
+  dd_MatrixPtr b_A;
   {
-    SEND_ERROR_MSG("numerical instability in cddlib. ill formed polytope");
-    return false;
+    // cdd lib keeps global state (e.g. statistics) while computing the double description,
+    // so only one projection at a time can run
+    std::lock_guard<std::mutex> lock(m_cdd_mutex);
+    PROFILE_START("dd_DDMatrix2Poly");
+    H_= dd_DDMatrix2Poly(V, &error);
+    PROFILE_STOP("dd_DDMatrix2Poly");
+    if(error != dd_NoError)
+    {
+      dd_FreeMatrix(V);
+      SEND_ERROR_MSG("numerical instability in cddlib. ill formed polytope");
+      return false;
+    }
+    b_A = dd_CopyInequalities(H_);
+    dd_FreePolyhedra(H_);
   }
+  dd_FreeMatrix(V);
 
-//  getProfiler().start("cdd to eigen");
-  dd_MatrixPtr b_A = dd_CopyInequalities(H_);
+  PROFILE_START("cdd to eigen");
   // get equalities and add them as complementary inequality constraints
   std::vector<long> eq_rows;
   for(long elem=1;elem<=(long)(b_A->linset[0]);++elem)
@@ -473,7 +1329,8 @@ bool StaticEquilibrium::computePolytopeProjection(Cref_matrix6X v)
     m_h(rowsize + i) = -m_h((int)(*cit));
     m_H(rowsize + i) = -m_H((int)(*cit));
   }
-//  getProfiler().stop("cdd to eigen");
+  dd_FreeMatrix(b_A);
+  PROFILE_STOP("cdd to eigen");
 
   return true;
 }
@@ -26,35 +26,279 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "robust-equilibrium-lib/Stdafx.hh"
 
-#ifndef WIN32
-	#include <sys/time.h>
-#else
-	#include <Windows.h>
-	#include <iomanip>
-#endif
-
 #include <iomanip>      // std::setprecision
+#include <chrono>
+#include <cmath>
 #include "robust-equilibrium-lib/stop-watch.hh"
 
 using std::map;
 using std::string;
+using std::vector;
 using std::ostringstream;
 
+namespace
+{
+  /** Names of the performances, indexed by their ID */
+  struct ScopeRegistry
+  {
+    std::mutex mutex;
+    map<string, Stopwatch::ScopeId> ids;
+    vector<string> names;
+  };
+
+  ScopeRegistry& scope_registry()
+  {
+    static ScopeRegistry r;
+    return r;
+  }
+
+  /** Return true and set id if the performance name has already been interned */
+  bool find_scope_id(const string& perf_name, Stopwatch::ScopeId& id)
+  {
+    ScopeRegistry& r = scope_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    map<string, Stopwatch::ScopeId>::const_iterator it = r.ids.find(perf_name);
+    if(it==r.ids.end())
+      return false;
+    id = it->second;
+    return true;
+  }
+
+  const Stopwatch::ScopeId ROOT_SCOPE = (Stopwatch::ScopeId)(-1);
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other)
+{
+  for(unsigned int i=0; i<N_BUCKETS; i++)
+    counts[i].store(other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  return *this;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+  for(unsigned int i=0; i<N_BUCKETS; i++)
+  {
+    uint64_t n = other.counts[i].load(std::memory_order_relaxed);
+    if(n>0)
+      counts[i].fetch_add(n, std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::reset()
+{
+  for(unsigned int i=0; i<N_BUCKETS; i++)
+    counts[i].store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_count() const
+{
+  uint64_t n = 0;
+  for(unsigned int i=0; i<N_BUCKETS; i++)
+    n += counts[i].load(std::memory_order_relaxed);
+  return n;
+}
+
+uint64_t LatencyHistogram::get_bucket_lower_bound(unsigned int bucket)
+{
+  if(bucket < SUB_BUCKETS)
+    return bucket;
+  unsigned int shift = bucket/SUB_BUCKETS - 1;
+  return (uint64_t)(SUB_BUCKETS + bucket%SUB_BUCKETS) << shift;
+}
+
+uint64_t LatencyHistogram::get_bucket_upper_bound(unsigned int bucket)
+{
+  if(bucket+1 >= N_BUCKETS)
+    return ~(uint64_t)0;
+  return get_bucket_lower_bound(bucket+1) - 1;
+}
+
+long double LatencyHistogram::get_percentile(double percentage) const
+{
+  uint64_t n = get_count();
+  if(n==0)
+    return 0.0;
+  // rank of the sample corresponding to the percentile, in [1, n]
+  uint64_t rank = (uint64_t)std::ceil(percentage*1e-2*n);
+  if(rank<1) rank = 1;
+  if(rank>n) rank = n;
+  uint64_t cumulated = 0;
+  unsigned int b = 0;
+  for(; b<N_BUCKETS; b++)
+  {
+    cumulated += counts[b].load(std::memory_order_relaxed);
+    if(cumulated>=rank)
+      break;
+  }
+  // return the middle of the bucket
+  long double lower = get_bucket_lower_bound(b);
+  long double upper = get_bucket_upper_bound(b);
+  return 0.5e-9L*(lower+upper);
+}
+
 Stopwatch& getProfiler()
 {
   static Stopwatch s(REAL_TIME);   // alternatives are CPU_TIME and REAL_TIME
   return s;
 }
 
+Stopwatch::ScopeId Stopwatch::get_scope_id(const string& perf_name)
+{
+  ScopeRegistry& r = scope_registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  map<string, ScopeId>::const_iterator it = r.ids.find(perf_name);
+  if(it!=r.ids.end())
+    return it->second;
+  ScopeId id = (ScopeId)r.names.size();
+  r.names.push_back(perf_name);
+  r.ids.insert(make_pair(perf_name, id));
+  return id;
+}
+
+string Stopwatch::get_scope_name(ScopeId id)
+{
+  ScopeRegistry& r = scope_registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  if(id>=r.names.size())
+    throw StopwatchException("Performance not initialized.");
+  return r.names[id];
+}
+
+void Stopwatch::PerformanceData::merge(const PerformanceData& other)
+{
+  if(other.stops==0)
+    return;
+  if(other.max_time >= max_time)  max_time = other.max_time;
+  if(other.min_time <= min_time || min_time == 0)
+    min_time = other.min_time;
+  last_time = other.last_time;
+  total_time += other.total_time;
+  stops += other.stops;
+  histogram.merge(other.histogram);
+}
+
+long double Stopwatch::PerformanceData::get_percentile(double percentage) const
+{
+  long double t = histogram.get_percentile(percentage);
+  if(t < min_time) return min_time;
+  if(t > max_time) return max_time;
+  return t;
+}
+
+Stopwatch::ThreadData::ThreadData()
+  : finished(false)
+{
+  nodes.push_back(ScopeNode(ROOT_SCOPE, -1));
+}
+
+int Stopwatch::ThreadData::get_child(int parent, ScopeId scope)
+{
+  const vector<int>& children = nodes[parent].children;
+  for(size_t i=0; i<children.size(); i++)
+    if(nodes[children[i]].scope==scope)
+      return children[i];
+  int child = (int)nodes.size();
+  nodes.push_back(ScopeNode(scope, parent));
+  nodes[parent].children.push_back(child);
+  return child;
+}
+
+void Stopwatch::ThreadData::merge(const ThreadData& other, int dst, int src)
+{
+  nodes[dst].data.merge(other.nodes[src].data);
+  for(size_t i=0; i<other.nodes[src].children.size(); i++)
+  {
+    int src_child = other.nodes[src].children[i];
+    int dst_child = get_child(dst, other.nodes[src_child].scope);
+    merge(other, dst_child, src_child);
+  }
+}
+
 Stopwatch::Stopwatch(StopwatchMode _mode) 
   : active(true), mode(_mode)  
 {
-  records_of = new map<string, PerformanceData>();
+  static std::atomic<unsigned long long> instance_counter(0);
+  instance_id = instance_counter++;
 }
 
 Stopwatch::~Stopwatch() 
 {
-  delete records_of;
+}
+
+Stopwatch::ThreadData& Stopwatch::thread_data()
+{
+  // Buffers of the calling thread for all the stopwatches it used. They are shared
+  // with the stopwatches, so they survive whichever of the two is destroyed first.
+  struct ThreadBuffers
+  {
+    vector<std::pair<unsigned long long, std::shared_ptr<ThreadData> > > buffers;
+    ~ThreadBuffers()
+    {
+      for(size_t i=0; i<buffers.size(); i++)
+      {
+        std::lock_guard<std::mutex> lock(buffers[i].second->mutex);
+        buffers[i].second->finished = true;
+      }
+    }
+  };
+  static thread_local ThreadBuffers tb;
+
+  for(size_t i=0; i<tb.buffers.size(); i++)
+    if(tb.buffers[i].first==instance_id)
+      return *tb.buffers[i].second;
+
+  std::shared_ptr<ThreadData> td = std::make_shared<ThreadData>();
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    // move the data of the threads that have exited into finished_threads,
+    // so that the number of buffers does not grow with the number of threads created
+    for(size_t i=0; i<threads.size(); )
+    {
+      std::lock_guard<std::mutex> lock_thread(threads[i]->mutex);
+      if(threads[i]->finished)
+      {
+        finished_threads.merge(*threads[i]);
+        threads[i].swap(threads.back());
+        threads.pop_back();
+      }
+      else
+        i++;
+    }
+    threads.push_back(td);
+  }
+  tb.buffers.push_back(std::make_pair(instance_id, td));
+  return *td;
+}
+
+void Stopwatch::collect(ThreadData& result)
+{
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  result.merge(finished_threads);
+  for(size_t i=0; i<threads.size(); i++)
+  {
+    std::lock_guard<std::mutex> lock_thread(threads[i]->mutex);
+    result.merge(*threads[i]);
+  }
+}
+
+Stopwatch::PerformanceData Stopwatch::get_data(const string& perf_name)
+{
+  ScopeId id;
+  if(!find_scope_id(perf_name, id))
+    throw StopwatchException("Performance not initialized.");
+  ThreadData all;
+  collect(all);
+  PerformanceData result;
+  bool found = false;
+  for(size_t i=1; i<all.nodes.size(); i++)
+    if(all.nodes[i].scope==id)
+    {
+      result.merge(all.nodes[i].data);
+      found = true;
+    }
+  if(!found)
+    throw StopwatchException("Performance not initialized.");
+  return result;
 }
 
 void Stopwatch::set_mode(StopwatchMode new_mode) 
@@ -64,7 +308,15 @@ void Stopwatch::set_mode(StopwatchMode new_mode)
 
 bool Stopwatch::performance_exists(string perf_name) 
 {
-  return (records_of->find(perf_name) != records_of->end());
+  ScopeId id;
+  if(!find_scope_id(perf_name, id))
+    return false;
+  ThreadData all;
+  collect(all);
+  for(size_t i=1; i<all.nodes.size(); i++)
+    if(all.nodes[i].scope==id)
+      return true;
+  return false;
 }
 
 long double Stopwatch::take_time() 
@@ -76,35 +328,9 @@ long double Stopwatch::take_time()
     
   } else if ( mode == REAL_TIME ) {
     
-    // Query operating system
-    
-#ifdef WIN32
-    /*	In case of usage under Windows */
-    FILETIME ft;
-    LARGE_INTEGER intervals;
-    
-    // Get the amount of 100 nanoseconds intervals elapsed since January 1, 1601
-    // (UTC)
-    GetSystemTimeAsFileTime(&ft);
-    intervals.LowPart = ft.dwLowDateTime;
-    intervals.HighPart = ft.dwHighDateTime;
-    
-    long double measure = intervals.QuadPart;
-    measure -= 116444736000000000.0;	// Convert to UNIX epoch time
-    measure /= 10000000.0;		// Convert to seconds
-    
-    return measure;
-#else
-    /* Linux, MacOS, ... */
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    
-    long double measure = tv.tv_usec;
-    measure /= 1000000.0;		// Convert to seconds
-    measure += tv.tv_sec;		// Add seconds part
-    
-    return measure;
-#endif
+    // Monotonic clock, read without a system call on most platforms
+    std::chrono::steady_clock::duration t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count() * 1e-9L;
     
   } else {
     // If mode == NONE, clock has not been initialized, then throw exception
@@ -113,41 +339,69 @@ long double Stopwatch::take_time()
 }
 
 void Stopwatch::start(string perf_name)  
+{
+  if (!active) return;
+  start(get_scope_id(perf_name));
+}
+
+void Stopwatch::start(ScopeId id)
 {
   if (!active) return;
   
-  // Just works if not already present
-  records_of->insert(make_pair(perf_name, PerformanceData()));
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
-  // Take ctime
-  perf_info.clock_start = take_time();
-  
-  // If this is a new start (i.e. not a restart)
-//  if (!perf_info.paused)
-//    perf_info.last_time = 0;
+  ThreadData& td = thread_data();
+  std::lock_guard<std::mutex> lock(td.mutex);
+  
+  // If the performance is already running just restart it,
+  // otherwise nest it into the innermost running performance
+  int node = -1;
+  for(int i=(int)td.stack.size()-1; i>=0; i--)
+    if(td.nodes[td.stack[i]].scope==id)
+    {
+      node = td.stack[i];
+      break;
+    }
+  if(node<0)
+  {
+    node = td.get_child(td.stack.empty() ? 0 : td.stack.back(), id);
+    td.stack.push_back(node);
+  }
   
-  perf_info.paused = false;
+  // Take time as late as possible
+  td.nodes[node].data.clock_start = take_time();
 }
 
 void Stopwatch::stop(string perf_name) 
+{
+  if (!active) return;
+  stop(get_scope_id(perf_name));
+}
+
+void Stopwatch::stop(ScopeId id)
 {
   if (!active) return;
   
   long double clock_end = take_time();
   
+  ThreadData& td = thread_data();
+  std::lock_guard<std::mutex> lock(td.mutex);
+  
   // Try to recover performance data
-  if ( !performance_exists(perf_name) )
+  int i = (int)td.stack.size()-1;
+  while(i>=0 && td.nodes[td.stack[i]].scope!=id)
+    i--;
+  if ( i<0 )
     throw StopwatchException("Performance not initialized.");
   
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
+  PerformanceData& perf_info = td.nodes[td.stack[i]].data;
+  td.stack.erase(td.stack.begin()+i);
   
   perf_info.stops++;
   long double  lapse = clock_end - perf_info.clock_start;
   
   if ( mode == CPU_TIME )
     lapse /= (double) CLOCKS_PER_SEC;
+  lapse += perf_info.paused_time;
+  perf_info.paused_time = 0;
   
   // Update last time
   perf_info.last_time = lapse;
@@ -159,35 +413,84 @@ void Stopwatch::stop(string perf_name)
   
   // Update total time
   perf_info.total_time += lapse;
+  
+  perf_info.histogram.record(lapse);
 }
 
 void Stopwatch::pause(string perf_name) 
+{
+  if (!active) return;
+  pause(get_scope_id(perf_name));
+}
+
+void Stopwatch::pause(ScopeId id)
 {
   if (!active) return;
   
-  long double  clock_end = clock();
+  long double clock_end = take_time();
+  
+  ThreadData& td = thread_data();
+  std::lock_guard<std::mutex> lock(td.mutex);
   
   // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
+  int i = (int)td.stack.size()-1;
+  while(i>=0 && td.nodes[td.stack[i]].scope!=id)
+    i--;
+  if ( i<0 )
     throw StopwatchException("Performance not initialized.");
   
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
+  PerformanceData& perf_info = td.nodes[td.stack[i]].data;
+  td.stack.erase(td.stack.begin()+i);
   
   long double  lapse = clock_end - perf_info.clock_start;
+  if ( mode == CPU_TIME )
+    lapse /= (double) CLOCKS_PER_SEC;
   
-  // Update total time
-  perf_info.last_time += lapse;
-  perf_info.total_time += lapse;
+  // Accumulate time until the next stop
+  perf_info.paused_time += lapse;
 }
 
 void Stopwatch::reset_all() 
 {
   if (!active) return;
   
-  map<string, PerformanceData>::iterator it;
-  
-  for (it = records_of->begin(); it != records_of->end(); ++it) {
-    reset(it->first);
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  for(size_t i=1; i<finished_threads.nodes.size(); i++)
+    finished_threads.nodes[i].data = PerformanceData();
+  for(size_t t=0; t<threads.size(); t++)
+  {
+    std::lock_guard<std::mutex> lock_thread(threads[t]->mutex);
+    for(size_t i=1; i<threads[t]->nodes.size(); i++)
+      threads[t]->nodes[i].data = PerformanceData();
+  }
+}
+
+void Stopwatch::get_all_records(vector<Record>& records)
+{
+  ThreadData all;
+  collect(all);
+  
+  records.clear();
+  // depth-first visit of the tree
+  vector<std::pair<int,string> > to_visit;   // (node, path of the parent)
+  for(int i=(int)all.nodes[0].children.size()-1; i>=0; i--)
+    to_visit.push_back(std::make_pair(all.nodes[0].children[i], string()));
+  vector<int> depth(all.nodes.size(), 0);
+  while(!to_visit.empty())
+  {
+    int node = to_visit.back().first;
+    Record r;
+    r.name = get_scope_name(all.nodes[node].scope);
+    r.path = to_visit.back().second.empty() ? r.name : to_visit.back().second+"/"+r.name;
+    r.depth = depth[node];
+    r.data = all.nodes[node].data;
+    to_visit.pop_back();
+    for(int i=(int)all.nodes[node].children.size()-1; i>=0; i--)
+    {
+      depth[all.nodes[node].children[i]] = r.depth+1;
+      to_visit.push_back(std::make_pair(all.nodes[node].children[i], r.path));
+    }
+    records.push_back(r);
   }
 }
 
@@ -195,11 +498,90 @@ void Stopwatch::report_all(int precision, std::ostream& output)
 {
   if (!active) return;
   
-  output<< "\n*** PROFILING RESULTS [ms] (min - avg - max - lastTime - nSamples) ***\n";
-  map<string, PerformanceData>::iterator it;
-  for (it = records_of->begin(); it != records_of->end(); ++it) {
-    report(it->first, precision, output);
+  vector<Record> records;
+  get_all_records(records);
+  
+  output<< "\n*** PROFILING RESULTS [ms] (min - avg - p50 - p99 - p99.9 - max - lastTime - nSamples) ***\n";
+  // indent the nested performances
+  for(size_t i=0; i<records.size(); i++)
+    report(string(2*records[i].depth, ' ')+records[i].name, records[i].data, precision, output);
+}
+
+void Stopwatch::report_all_csv(std::ostream& output)
+{
+  vector<Record> records;
+  get_all_records(records);
+  
+  output << "name,samples,total,min,avg,p50,p90,p99,p99.9,max\n";
+  for(size_t i=0; i<records.size(); i++)
+  {
+    const PerformanceData& p = records[i].data;
+    string name = records[i].path;
+    // quote the name if needed
+    if(name.find_first_of(",\"\n")!=string::npos)
+    {
+      string quoted = "\"";
+      for(size_t j=0; j<name.size(); j++)
+        quoted += (name[j]=='"') ? string("\"\"") : string(1, name[j]);
+      name = quoted+"\"";
+    }
+    output << name << "," << p.stops << std::setprecision(9)
+           << "," << p.total_time*1e3
+           << "," << p.min_time*1e3
+           << "," << (p.stops>0 ? p.total_time*1e3/p.stops : 0.0)
+           << "," << p.get_percentile(50.0)*1e3
+           << "," << p.get_percentile(90.0)*1e3
+           << "," << p.get_percentile(99.0)*1e3
+           << "," << p.get_percentile(99.9)*1e3
+           << "," << p.max_time*1e3 << "\n";
   }
+  output.flush();
+}
+
+void Stopwatch::report_all_json(std::ostream& output)
+{
+  vector<Record> records;
+  get_all_records(records);
+  
+  output << "{\"unit\": \"ms\", \"records\": [";
+  for(size_t i=0; i<records.size(); i++)
+  {
+    const PerformanceData& p = records[i].data;
+    string name;
+    for(size_t j=0; j<records[i].path.size(); j++)
+    {
+      char c = records[i].path[j];
+      if(c=='"' || c=='\\')
+        name += '\\';
+      if((unsigned char)c < 0x20)
+        name += ' ';
+      else
+        name += c;
+    }
+    output << (i==0 ? "\n" : ",\n")
+           << "  {\"name\": \"" << name << "\", \"samples\": " << p.stops << std::setprecision(9)
+           << ", \"total\": " << p.total_time*1e3
+           << ", \"min\": " << p.min_time*1e3
+           << ", \"avg\": " << (p.stops>0 ? p.total_time*1e3/p.stops : 0.0)
+           << ", \"p50\": " << p.get_percentile(50.0)*1e3
+           << ", \"p90\": " << p.get_percentile(90.0)*1e3
+           << ", \"p99\": " << p.get_percentile(99.0)*1e3
+           << ", \"p99.9\": " << p.get_percentile(99.9)*1e3
+           << ", \"max\": " << p.max_time*1e3
+           << ", \"histogram_ns\": [";
+    bool first = true;
+    for(unsigned int b=0; b<LatencyHistogram::N_BUCKETS; b++)
+    {
+      uint64_t n = p.histogram.get_bucket_count(b);
+      if(n==0)
+        continue;
+      output << (first ? "" : ", ") << "[" << LatencyHistogram::get_bucket_upper_bound(b) << ", " << n << "]";
+      first = false;
+    }
+    output << "]}";
+  }
+  output << "\n]}\n";
+  output.flush();
 }
 
 void Stopwatch::reset(string perf_name) 
@@ -207,18 +589,21 @@ void Stopwatch::reset(string perf_name)
   if (!active) return;
   
   // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
+  ScopeId id;
+  if ( !performance_exists(perf_name) || !find_scope_id(perf_name, id) )
     throw StopwatchException("Performance not initialized.");
   
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
-  perf_info.clock_start = 0;
-  perf_info.total_time = 0;
-  perf_info.min_time = 0;
-  perf_info.max_time = 0;
-  perf_info.last_time = 0;
-  perf_info.paused = false;
-  perf_info.stops = 0;
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  for(size_t i=1; i<finished_threads.nodes.size(); i++)
+    if(finished_threads.nodes[i].scope==id)
+      finished_threads.nodes[i].data = PerformanceData();
+  for(size_t t=0; t<threads.size(); t++)
+  {
+    std::lock_guard<std::mutex> lock_thread(threads[t]->mutex);
+    for(size_t i=1; i<threads[t]->nodes.size(); i++)
+      if(threads[t]->nodes[i].scope==id)
+        threads[t]->nodes[i].data = PerformanceData();
+  }
 }
 
 void Stopwatch::turn_on() 
@@ -237,12 +622,12 @@ void Stopwatch::report(string perf_name, int precision, std::ostream& output)
 {
   if (!active) return;
   
-  // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
-    throw StopwatchException("Performance not initialized.");
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
+  report(perf_name, get_data(perf_name), precision, output);
+}
+
+void Stopwatch::report(const string& perf_name, const PerformanceData& perf_info,
+                       int precision, std::ostream& output)
+{
   const int MAX_NAME_LENGTH = 60;
   string pad = "";
   for (int i = perf_name.length(); i<MAX_NAME_LENGTH; i++)
@@ -253,6 +638,12 @@ void Stopwatch::report(string perf_name, int precision, std::ostream& output)
          << (perf_info.min_time*1e3) << "\t";
   output << std::fixed << std::setprecision(precision) 
          << (perf_info.total_time*1e3 / (long double) perf_info.stops) << "\t";
+  output << std::fixed << std::setprecision(precision) 
+         << (perf_info.get_percentile(50.0)*1e3) << "\t";
+  output << std::fixed << std::setprecision(precision) 
+         << (perf_info.get_percentile(99.0)*1e3) << "\t";
+  output << std::fixed << std::setprecision(precision) 
+         << (perf_info.get_percentile(99.9)*1e3) << "\t";
   output << std::fixed << std::setprecision(precision) 
          << (perf_info.max_time*1e3) << "\t";
   output << std::fixed << std::setprecision(precision)
@@ -269,11 +660,20 @@ void Stopwatch::report(string perf_name, int precision, std::ostream& output)
 long double Stopwatch::get_time_so_far(string perf_name) 
 {
   // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
+  ScopeId id;
+  if ( !find_scope_id(perf_name, id) )
+    throw StopwatchException("Performance not initialized.");
+  
+  ThreadData& td = thread_data();
+  std::lock_guard<std::mutex> lock(td.mutex);
+  int i = (int)td.stack.size()-1;
+  while(i>=0 && td.nodes[td.stack[i]].scope!=id)
+    i--;
+  if ( i<0 )
     throw StopwatchException("Performance not initialized.");
   
   long double lapse = 
-    (take_time() - (records_of->find(perf_name)->second).clock_start);
+    (take_time() - td.nodes[td.stack[i]].data.clock_start);
   
   if (mode == CPU_TIME)
     lapse /= (double) CLOCKS_PER_SEC;
@@ -283,59 +683,31 @@ long double Stopwatch::get_time_so_far(string perf_name)
 
 long double Stopwatch::get_total_time(string perf_name) 
 {
-  // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
-    throw StopwatchException("Performance not initialized.");
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
-  return perf_info.total_time;
-  
+  return get_data(perf_name).total_time;
 }
 
 long double Stopwatch::get_average_time(string perf_name) 
 {
-  // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
-    throw StopwatchException("Performance not initialized.");
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
+  PerformanceData perf_info = get_data(perf_name);
   return (perf_info.total_time / (long double)perf_info.stops);
-  
 }
 
 long double Stopwatch::get_min_time(string perf_name) 
 {
-  // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
-    throw StopwatchException("Performance not initialized.");
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
-  return perf_info.min_time;
-  
+  return get_data(perf_name).min_time;
 }
 
 long double Stopwatch::get_max_time(string perf_name) 
 {
-  // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
-    throw StopwatchException("Performance not initialized.");
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
-  return perf_info.max_time;
-  
+  return get_data(perf_name).max_time;
 }
 
 long double Stopwatch::get_last_time(string perf_name) 
 {
-  // Try to recover performance data
-  if ( !performance_exists(perf_name)  )
-    throw StopwatchException("Performance not initialized.");
-  
-  PerformanceData& perf_info = records_of->find(perf_name)->second;
-  
-  return perf_info.last_time;
+  return get_data(perf_name).last_time;
+}
+
+long double Stopwatch::get_percentile(string perf_name, double percentage)
+{
+  return get_data(perf_name).get_percentile(percentage);
 }
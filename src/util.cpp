@@ -8,13 +8,13 @@
 
 #include <robust-equilibrium-lib/util.hh>
 #include <ctime>
+#include <mutex>
 
 namespace robust_equilibrium
 {
 
 dd_MatrixPtr cone_span_eigen_to_cdd(Cref_matrixXX input)
 {
-  dd_debug = false;
   dd_MatrixPtr M=NULL;
   dd_rowrange i;
   dd_colrange j;
@@ -46,8 +46,12 @@ dd_MatrixPtr cone_span_eigen_to_cdd(Cref_matrixXX input)
 
 void init_cdd_library()
 {
-  dd_set_global_constants();
-  dd_debug = false;
+  static std::once_flag initialized;
+  std::call_once(initialized, []()
+  {
+    dd_set_global_constants();
+    dd_debug = false;
+  });
 }
 
 void release_cdd_library()
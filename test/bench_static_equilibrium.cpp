@@ -0,0 +1,303 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <robust-equilibrium-lib/static_equilibrium.hh>
+#include <robust-equilibrium-lib/logger.hh>
+#include <robust-equilibrium-lib/stop-watch.hh>
+
+using namespace robust_equilibrium;
+using namespace std;
+
+/** Benchmark of the StaticEquilibrium methods on fixed-seed random scenarios.
+ * Usage: bench_static_equilibrium [--output file.json] [--repetitions N] [--max-pp-generators N]
+ * The results are printed on screen and, if an output file is specified, saved in JSON format.
+ */
+
+#define SEED 1446555515
+
+/** Latency measurements of a method on a scenario */
+struct Measurement
+{
+  string            algorithm;
+  string            backend;
+  unsigned int      n_contacts;
+  unsigned int      generators_per_contact;
+  string            method;
+  unsigned int      calls;
+  unsigned int      failures;     /// calls that returned an error
+  double            total_time;   /// seconds
+  double            max_time;     /// seconds
+  LatencyHistogram  histogram;
+
+  Measurement(const string& algorithm, const string& backend, unsigned int n_contacts,
+              unsigned int generators_per_contact, const string& method)
+    : algorithm(algorithm), backend(backend), n_contacts(n_contacts),
+      generators_per_contact(generators_per_contact), method(method),
+      calls(0), failures(0), total_time(0.0), max_time(0.0) {}
+
+  void add(double time, bool failed)
+  {
+    calls++;
+    if(failed)
+      failures++;
+    total_time += time;
+    if(time>max_time)
+      max_time = time;
+    histogram.record(time);
+  }
+};
+
+/** Configuration of a StaticEquilibrium object to benchmark */
+struct SolverConfig
+{
+  string                      algorithm_name;
+  StaticEquilibriumAlgorithm  algorithm;
+  string                      backend_name;
+  SolverLP                    backend;
+};
+
+typedef chrono::steady_clock Clock;
+
+inline double elapsed(const Clock::time_point& start)
+{
+  return chrono::duration<double>(Clock::now()-start).count();
+}
+
+/** Generate n_contacts contact points as the corners of randomly placed rectangular
+ * contact surfaces (the last surface can have less than 4 corners).
+ */
+void generateContacts(unsigned int n_contacts, MatrixXX& p, MatrixXX& N)
+{
+  const double mu = 0.3;
+  const double MIN_CONTACT_DISTANCE = 0.3;
+  const double LX = 0.5*0.2172;        // half contact surface size in x direction
+  const double LY = 0.5*0.138;         // half contact surface size in y direction
+  RVector3 CONTACT_POINT_LOWER_BOUNDS, CONTACT_POINT_UPPER_BOUNDS;
+  RVector3 RPY_LOWER_BOUNDS, RPY_UPPER_BOUNDS;
+  CONTACT_POINT_LOWER_BOUNDS << 0.0,  0.0,  0.0;
+  CONTACT_POINT_UPPER_BOUNDS << 0.5,  0.5,  0.5;
+  double gamma = atan(mu);   // half friction cone angle
+  RPY_LOWER_BOUNDS << -2*gamma, -2*gamma, -M_PI;
+  RPY_UPPER_BOUNDS << +2*gamma, +2*gamma, +M_PI;
+
+  unsigned int n_surfaces = (n_contacts+3)/4;
+  MatrixXX contact_pos = MatrixXX::Zero(n_surfaces, 3);
+  MatrixXX contact_rpy = MatrixXX::Zero(n_surfaces, 3);
+  MatrixXX p_all(4*n_surfaces, 3), N_all(4*n_surfaces, 3);
+  for(unsigned int i=0; i<n_surfaces; i++)
+  {
+    while(true) // generate contact position
+    {
+      uniform(CONTACT_POINT_LOWER_BOUNDS, CONTACT_POINT_UPPER_BOUNDS, contact_pos.row(i));
+      bool collision = false;
+      for(unsigned int j=0; j<i; j++)
+        if((contact_pos.row(i)-contact_pos.row(j)).norm() < MIN_CONTACT_DISTANCE)
+          collision = true;
+      if(collision==false)
+        break;
+    }
+    uniform(RPY_LOWER_BOUNDS, RPY_UPPER_BOUNDS, contact_rpy.row(i));
+    generate_rectangle_contacts(LX, LY, contact_pos.row(i), contact_rpy.row(i),
+                                p_all.middleRows<4>(i*4), N_all.middleRows<4>(i*4));
+  }
+  p = p_all.topRows(n_contacts);
+  N = N_all.topRows(n_contacts);
+}
+
+/** Generate a grid of com positions covering the contact points */
+void generateComGrid(Cref_matrixXX p, unsigned int grid_size, MatrixXX& coms)
+{
+  const double MARGIN = 0.07;
+  VectorX x_range(grid_size), y_range(grid_size);
+  x_range.setLinSpaced(grid_size, p.col(0).minCoeff()-MARGIN, p.col(0).maxCoeff()+MARGIN);
+  y_range.setLinSpaced(grid_size, p.col(1).minCoeff()-MARGIN, p.col(1).maxCoeff()+MARGIN);
+  coms.setZero(grid_size*grid_size, 3);
+  for(unsigned int i=0; i<grid_size; i++)
+    for(unsigned int j=0; j<grid_size; j++)
+    {
+      coms(i*grid_size+j, 0) = x_range(j);
+      coms(i*grid_size+j, 1) = y_range(i);
+    }
+}
+
+void printMeasurement(const Measurement& m)
+{
+  printf("%-4s %-8s %2d contacts %2d generators %-30s %5d calls %4d failures  avg %9.1f us  p50 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+         m.algorithm.c_str(), m.backend.c_str(), m.n_contacts, m.generators_per_contact, m.method.c_str(),
+         m.calls, m.failures, 1e6*m.total_time/m.calls, 1e6*(double)m.histogram.get_percentile(50.0),
+         1e6*(double)m.histogram.get_percentile(99.0), 1e6*m.max_time);
+}
+
+void writeJson(ostream& out, const vector<Measurement>& measurements, unsigned int repetitions)
+{
+  out<<"{\n  \"seed\": "<<SEED<<",\n  \"repetitions\": "<<repetitions<<",\n  \"unit\": \"us\",\n  \"results\": [";
+  for(size_t i=0; i<measurements.size(); i++)
+  {
+    const Measurement& m = measurements[i];
+    out<<(i==0 ? "\n" : ",\n")
+       <<"    {\"algorithm\": \""<<m.algorithm<<"\", \"backend\": \""<<m.backend<<"\""
+       <<", \"contacts\": "<<m.n_contacts<<", \"generators_per_contact\": "<<m.generators_per_contact
+       <<", \"method\": \""<<m.method<<"\", \"calls\": "<<m.calls<<", \"failures\": "<<m.failures
+       <<", \"throughput_per_s\": "<<(m.total_time>0.0 ? m.calls/m.total_time : 0.0)
+       <<", \"mean\": "<<1e6*m.total_time/m.calls
+       <<", \"p50\": "<<1e6*(double)m.histogram.get_percentile(50.0)
+       <<", \"p90\": "<<1e6*(double)m.histogram.get_percentile(90.0)
+       <<", \"p99\": "<<1e6*(double)m.histogram.get_percentile(99.0)
+       <<", \"max\": "<<1e6*m.max_time<<"}";
+  }
+  out<<"\n  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+  string output_file = "";
+  unsigned int repetitions = 5;       // number of times each scenario is repeated
+  unsigned int max_pp_generators = 256; // PP is skipped on scenarios with more generators
+  for(int i=1; i<argc; i++)
+  {
+    if(strcmp(argv[i], "--output")==0 && i+1<argc)
+      output_file = argv[++i];
+    else if(strcmp(argv[i], "--repetitions")==0 && i+1<argc)
+      repetitions = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--max-pp-generators")==0 && i+1<argc)
+      max_pp_generators = atoi(argv[++i]);
+    else
+    {
+      cout<<"Usage: "<<argv[0]<<" [--output file.json] [--repetitions N] [--max-pp-generators N]\n";
+      return -1;
+    }
+  }
+
+  // failed LP solves are part of the benchmark, do not print them
+  getLogger().setVerbosity(VERBOSITY_ERROR);
+
+  const double mass = 55.0;
+  const double mu = 0.3;
+  const double e_max = 10.0;
+  const unsigned int GRID_SIZE = 10;
+  const unsigned int N_LINES = 20;   // number of lines tested with findExtremumOverLine
+  const unsigned int N_CONTACTS[] = {2, 4, 8, 16};
+  const unsigned int N_GENERATORS[] = {4, 8, 16, 32};
+
+  vector<SolverConfig> configs;
+  {
+    string alg_names[] = {"LP", "LP2", "DLP", "IP", "DIP"};
+    StaticEquilibriumAlgorithm algs[] = {STATIC_EQUILIBRIUM_ALGORITHM_LP, STATIC_EQUILIBRIUM_ALGORITHM_LP2,
+                                         STATIC_EQUILIBRIUM_ALGORITHM_DLP, STATIC_EQUILIBRIUM_ALGORITHM_IP,
+                                         STATIC_EQUILIBRIUM_ALGORITHM_DIP};
+    for(int a=0; a<5; a++)
+    {
+      SolverConfig c = {alg_names[a], algs[a], "qpOASES", SOLVER_LP_QPOASES};
+      configs.push_back(c);
+#ifdef CLP_FOUND
+      c.backend_name = "CLP";
+      c.backend = SOLVER_LP_CLP;
+      configs.push_back(c);
+#endif
+    }
+    SolverConfig c = {"PP", STATIC_EQUILIBRIUM_ALGORITHM_PP, "cdd", SOLVER_LP_QPOASES};
+    configs.push_back(c);
+  }
+
+  vector<Measurement> measurements;
+  MatrixXX p, N, coms;
+  Vector3 a, a0, com;
+  double robustness;
+  bool equilibrium;
+  for(unsigned int ic=0; ic<4; ic++)
+  {
+    for(unsigned int ig=0; ig<4; ig++)
+    {
+      const unsigned int n_contacts = N_CONTACTS[ic];
+      const unsigned int n_gen = N_GENERATORS[ig];
+      for(size_t s=0; s<configs.size(); s++)
+      {
+        const SolverConfig& conf = configs[s];
+        const StaticEquilibriumAlgorithm alg = conf.algorithm;
+        if(alg==STATIC_EQUILIBRIUM_ALGORITHM_PP && n_contacts*n_gen>max_pp_generators)
+          continue;
+
+        StaticEquilibrium solver(conf.algorithm_name+" "+conf.backend_name, mass, n_gen, conf.backend);
+        Measurement m_setup(conf.algorithm_name, conf.backend_name, n_contacts, n_gen, "setNewContacts");
+        Measurement m_rob(conf.algorithm_name, conf.backend_name, n_contacts, n_gen, "computeEquilibriumRobustness");
+        Measurement m_check(conf.algorithm_name, conf.backend_name, n_contacts, n_gen, "checkRobustEquilibrium");
+        Measurement m_line(conf.algorithm_name, conf.backend_name, n_contacts, n_gen, "findExtremumOverLine");
+
+        // same scenarios for all the solvers
+        srand(SEED + 1000*n_contacts + n_gen);
+        for(unsigned int r=0; r<repetitions; r++)
+        {
+          generateContacts(n_contacts, p, N);
+          generateComGrid(p, GRID_SIZE, coms);
+
+          Clock::time_point start = Clock::now();
+          bool success = solver.setNewContacts(p, N, mu, alg);
+          m_setup.add(elapsed(start), !success);
+          if(!success)
+            continue;
+
+          if(alg!=STATIC_EQUILIBRIUM_ALGORITHM_IP && alg!=STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+            for(unsigned int i=0; i<coms.rows(); i++)
+            {
+              start = Clock::now();
+              LP_status status = solver.computeEquilibriumRobustness(coms.row(i), robustness);
+              m_rob.add(elapsed(start), status==LP_STATUS_ERROR);
+            }
+
+          if(alg==STATIC_EQUILIBRIUM_ALGORITHM_PP || alg==STATIC_EQUILIBRIUM_ALGORITHM_IP ||
+             alg==STATIC_EQUILIBRIUM_ALGORITHM_DIP)
+            for(unsigned int i=0; i<coms.rows(); i++)
+            {
+              start = Clock::now();
+              LP_status status = solver.checkRobustEquilibrium(coms.row(i), equilibrium);
+              m_check.add(elapsed(start), status==LP_STATUS_ERROR);
+            }
+
+          if(alg==STATIC_EQUILIBRIUM_ALGORITHM_LP || alg==STATIC_EQUILIBRIUM_ALGORITHM_DLP)
+          {
+            a0.setZero();
+            a0.head<2>() = p.leftCols<2>().colwise().mean().transpose();
+            for(unsigned int i=0; i<N_LINES; i++)
+            {
+              double angle = 2*M_PI*i/N_LINES;
+              a << cos(angle), sin(angle), 0.0;
+              start = Clock::now();
+              LP_status status = solver.findExtremumOverLine(a, a0, e_max, com);
+              m_line.add(elapsed(start), status==LP_STATUS_ERROR);
+            }
+          }
+        }
+
+        Measurement* all[] = {&m_setup, &m_rob, &m_check, &m_line};
+        for(int i=0; i<4; i++)
+          if(all[i]->calls>0)
+          {
+            printMeasurement(*all[i]);
+            measurements.push_back(*all[i]);
+          }
+      }
+    }
+  }
+
+  if(output_file!="")
+  {
+    ofstream out(output_file.c_str());
+    if(!out.is_open())
+    {
+      SEND_ERROR_MSG("Error while opening file "+output_file);
+      return -1;
+    }
+    writeJson(out, measurements, repetitions);
+    cout<<"Results saved in "<<output_file<<endl;
+  }
+  return 0;
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright 2015, LAAS-CNRS
+ * Author: Andrea Del Prete
+ */
+
+#ifndef WIN32
+#include <dirent.h>
+#else
+#include <Windows.h>
+#endif
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <robust-equilibrium-lib/solver_LP_abstract.hh>
+#include <robust-equilibrium-lib/matrix_archive.hh>
+#include <robust-equilibrium-lib/logger.hh>
+
+using namespace robust_equilibrium;
+using namespace std;
+
+/** Replay the LPs saved with Solver_LP_abstract::writeLpToFile.
+ * Usage: replay_LP [directory] [--archive file] [--save-archive file] [--repetitions N] [--output file.json]
+ * Every file "name.dat" of the directory that has a matching "name_solution.dat" is loaded
+ * and solved with all the available LP solvers, with and without warm start.
+ * With --archive the LPs are loaded from a MatrixArchive instead, which must contain for each
+ * LP "name" a matrix "name_solution". With --save-archive the loaded LPs are saved in such an archive.
+ * With warm start the same solver object solves all the LPs in alphabetical order, so
+ * LPs with the same size are warm started from the previous one (as it happens when
+ * the LPs come from the same StaticEquilibrium object).
+ * The solutions are checked against the stored ones, and solve times and iteration
+ * numbers are reported.
+ */
+
+#define EPS 1e-6
+
+struct LP
+{
+  string  name;
+  VectorX c, lb, ub, Alb, Aub, solution;
+  MatrixXX A;
+};
+
+/** Statistics of the solutions of an LP with a solver configuration */
+struct ReplayStats
+{
+  string        lp_name;
+  string        solver_name;
+  bool          warm_start;
+  unsigned int  calls;
+  unsigned int  failures;         /// solves that did not return LP_STATUS_OPTIMAL
+  unsigned int  wrong_solutions;  /// optimal solves with a cost different from the stored solution
+  double        total_time, min_time, max_time;   /// seconds
+  unsigned long total_iterations;
+  unsigned int  max_iterations;
+
+  ReplayStats(const string& lp_name, const string& solver_name, bool warm_start)
+    : lp_name(lp_name), solver_name(solver_name), warm_start(warm_start), calls(0),
+      failures(0), wrong_solutions(0), total_time(0.0), min_time(0.0), max_time(0.0),
+      total_iterations(0), max_iterations(0) {}
+};
+
+/** Return the names (without extension) of the LP files of the directory
+ * that have a matching solution file, in alphabetical order. */
+bool listLpFiles(const string& directory, vector<string>& names)
+{
+  vector<string> files;
+#ifndef WIN32
+  DIR* dir = opendir(directory.c_str());
+  if(dir==NULL)
+    return false;
+  for(struct dirent* entry=readdir(dir); entry!=NULL; entry=readdir(dir))
+    files.push_back(entry->d_name);
+  closedir(dir);
+#else
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA((directory+"\\*").c_str(), &data);
+  if(h==INVALID_HANDLE_VALUE)
+    return false;
+  do
+    files.push_back(data.cFileName);
+  while(FindNextFileA(h, &data));
+  FindClose(h);
+#endif
+
+  const string EXT = ".dat";
+  const string SOL = "_solution";
+  sort(files.begin(), files.end());
+  names.clear();
+  for(size_t i=0; i<files.size(); i++)
+  {
+    const string& f = files[i];
+    if(f.size()<=EXT.size() || f.compare(f.size()-EXT.size(), EXT.size(), EXT)!=0)
+      continue;
+    string name = f.substr(0, f.size()-EXT.size());
+    if(binary_search(files.begin(), files.end(), name+SOL+EXT))
+      names.push_back(name);
+  }
+  return true;
+}
+
+/** Load the LPs (with their solutions) stored in the files of the directory */
+bool loadDirectory(string directory, vector<LP>& lps)
+{
+  if(directory[directory.size()-1]!='/')
+    directory += "/";
+  vector<string> names;
+  if(!listLpFiles(directory, names))
+  {
+    SEND_ERROR_MSG("Impossible to read directory "+directory);
+    return false;
+  }
+
+  Solver_LP_abstract* reader = Solver_LP_abstract::getNewSolver(SOLVER_LP_QPOASES);
+  for(size_t i=0; i<names.size(); i++)
+  {
+    LP lp;
+    lp.name = names[i];
+    if(!reader->readLpFromFile(directory+names[i]+".dat", lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub))
+    {
+      SEND_WARNING_MSG("Error while reading LP from file "+names[i]+", skip it");
+      continue;
+    }
+    if(!readMatrixFromFile(directory+names[i]+"_solution.dat", lp.solution) || lp.solution.size()!=lp.c.size())
+    {
+      SEND_WARNING_MSG("Error while reading LP solution from file "+names[i]+"_solution, skip it");
+      continue;
+    }
+    lps.push_back(lp);
+  }
+  delete reader;
+  return true;
+}
+
+/** Load the LPs (with their solutions) stored in the archive */
+bool loadArchive(const string& filename, vector<LP>& lps)
+{
+  MatrixArchive archive;
+  if(!archive.open(filename))
+    return false;
+  MatrixArchive::LpView view;
+  for(size_t i=0; i<archive.size(); i++)
+  {
+    if(archive.getType(i)!=ARCHIVE_ENTRY_LP)
+      continue;
+    LP lp;
+    lp.name = archive.getName(i);
+    archive.getLp(lp.name, view);
+    lp.c = view.c.cast<value_type>();
+    lp.lb = view.lb.cast<value_type>();
+    lp.ub = view.ub.cast<value_type>();
+    lp.A = view.A.cast<value_type>();
+    lp.Alb = view.Alb.cast<value_type>();
+    lp.Aub = view.Aub.cast<value_type>();
+    MatrixXX solution;
+    if(!archive.readMatrix(lp.name+"_solution", solution) || solution.size()!=lp.c.size())
+    {
+      SEND_WARNING_MSG("Archive does not contain the solution of LP "+lp.name+", skip it");
+      continue;
+    }
+    lp.solution = Eigen::Map<VectorX>(solution.data(), solution.size());
+    lps.push_back(lp);
+  }
+  return true;
+}
+
+void printStats(const ReplayStats& s)
+{
+  printf("%-45s %-8s %-5s %4d solves %3d failed %3d wrong  time avg %9.1f min %9.1f max %9.1f us  iter avg %6.1f max %4d\n",
+         s.lp_name.c_str(), s.solver_name.c_str(), s.warm_start ? "warm" : "cold", s.calls, s.failures,
+         s.wrong_solutions, 1e6*s.total_time/s.calls, 1e6*s.min_time, 1e6*s.max_time,
+         (double)s.total_iterations/s.calls, s.max_iterations);
+}
+
+void writeJson(ostream& out, const vector<ReplayStats>& stats)
+{
+  out<<"{\n  \"unit\": \"us\",\n  \"results\": [";
+  for(size_t i=0; i<stats.size(); i++)
+  {
+    const ReplayStats& s = stats[i];
+    out<<(i==0 ? "\n" : ",\n")
+       <<"    {\"lp\": \""<<s.lp_name<<"\", \"solver\": \""<<s.solver_name<<"\""
+       <<", \"warm_start\": "<<(s.warm_start ? "true" : "false")
+       <<", \"solves\": "<<s.calls<<", \"failures\": "<<s.failures<<", \"wrong_solutions\": "<<s.wrong_solutions
+       <<", \"mean_time\": "<<1e6*s.total_time/s.calls<<", \"min_time\": "<<1e6*s.min_time
+       <<", \"max_time\": "<<1e6*s.max_time
+       <<", \"mean_iterations\": "<<(double)s.total_iterations/s.calls<<", \"max_iterations\": "<<s.max_iterations<<"}";
+  }
+  out<<"\n  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+  string directory = "../test_data/";
+  string output_file = "";
+  string archive_file = "";
+  string save_archive_file = "";
+  unsigned int repetitions = 10;
+  for(int i=1; i<argc; i++)
+  {
+    if(strcmp(argv[i], "--repetitions")==0 && i+1<argc)
+      repetitions = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--output")==0 && i+1<argc)
+      output_file = argv[++i];
+    else if(strcmp(argv[i], "--archive")==0 && i+1<argc)
+      archive_file = argv[++i];
+    else if(strcmp(argv[i], "--save-archive")==0 && i+1<argc)
+      save_archive_file = argv[++i];
+    else if(argv[i][0]!='-')
+      directory = argv[i];
+    else
+    {
+      cout<<"Usage: "<<argv[0]<<" [directory] [--archive file] [--save-archive file] [--repetitions N] [--output file.json]\n";
+      return -1;
+    }
+  }
+
+  vector<LP> lps;
+  if(archive_file!="")
+  {
+    if(!loadArchive(archive_file, lps))
+      return -1;
+    cout<<"Loaded "<<lps.size()<<" LPs from "<<archive_file<<endl;
+  }
+  else
+  {
+    if(!loadDirectory(directory, lps))
+      return -1;
+    cout<<"Loaded "<<lps.size()<<" LPs from "<<directory<<endl;
+  }
+  if(lps.empty())
+  {
+    SEND_ERROR_MSG("No LP to replay");
+    return -1;
+  }
+
+  if(save_archive_file!="")
+  {
+    MatrixArchiveWriter writer;
+    bool res = writer.open(save_archive_file);
+    for(size_t i=0; i<lps.size() && res; i++)
+    {
+      const LP& lp = lps[i];
+      res = writer.addLp(lp.name, lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub) &&
+            writer.addMatrix(lp.name+"_solution", lp.solution);
+    }
+    if(!writer.close() || !res)
+      return -1;
+    cout<<"LPs saved in "<<save_archive_file<<endl;
+  }
+
+  vector<SolverLP> solver_types;
+  vector<string> solver_names;
+  solver_types.push_back(SOLVER_LP_QPOASES);
+  solver_names.push_back("qpOASES");
+#ifdef CLP_FOUND
+  solver_types.push_back(SOLVER_LP_CLP);
+  solver_names.push_back("CLP");
+#endif
+
+  vector<ReplayStats> stats;
+  VectorX sol;
+  for(size_t s=0; s<solver_types.size(); s++)
+  {
+    for(int warm=0; warm<2; warm++)
+    {
+      Solver_LP_abstract* solver = Solver_LP_abstract::getNewSolver(solver_types[s]);
+      solver->setUseWarmStart(warm==1);
+      size_t first = stats.size();
+      for(size_t i=0; i<lps.size(); i++)
+        stats.push_back(ReplayStats(lps[i].name, solver_names[s], warm==1));
+
+      for(unsigned int r=0; r<repetitions; r++)
+      {
+        for(size_t i=0; i<lps.size(); i++)
+        {
+          const LP& lp = lps[i];
+          ReplayStats& st = stats[first+i];
+          sol.resize(lp.c.size());
+
+          chrono::steady_clock::time_point start = chrono::steady_clock::now();
+          LP_status status = solver->solve(lp.c, lp.lb, lp.ub, lp.A, lp.Alb, lp.Aub, sol);
+          double time = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+
+          unsigned int iterations = solver->getNumberOfIterations();
+          st.calls++;
+          st.total_time += time;
+          if(st.calls==1 || time<st.min_time) st.min_time = time;
+          if(time>st.max_time) st.max_time = time;
+          st.total_iterations += iterations;
+          if(iterations>st.max_iterations) st.max_iterations = iterations;
+
+          if(status!=LP_STATUS_OPTIMAL)
+            st.failures++;
+          else if(!sol.isApprox(lp.solution, EPS))
+          {
+            // a different solution with the same cost is fine
+            double cost = lp.c.dot(sol), expected_cost = lp.c.dot(lp.solution);
+            if(fabs(cost-expected_cost) > EPS*(1.0+fabs(expected_cost)))
+              st.wrong_solutions++;
+          }
+        }
+      }
+      delete solver;
+
+      for(size_t i=first; i<stats.size(); i++)
+        printStats(stats[i]);
+    }
+  }
+
+  if(output_file!="")
+  {
+    ofstream out(output_file.c_str());
+    if(!out.is_open())
+    {
+      SEND_ERROR_MSG("Error while opening file "+output_file);
+      return -1;
+    }
+    writeJson(out, stats);
+    cout<<"Results saved in "<<output_file<<endl;
+  }
+
+  int errors = 0;
+  for(size_t i=0; i<stats.size(); i++)
+    errors += stats[i].failures + stats[i].wrong_solutions;
+  cout<<"Replay of "<<lps.size()<<" LPs: "<<errors<<" error(s).\n";
+  return errors>0 ? -1 : 0;
+}
@@ -13,6 +13,8 @@
 
 #include <qpOASES.hpp>
 #include <robust-equilibrium-lib/solver_LP_qpoases.hh>
+#include <robust-equilibrium-lib/lp_capture.hh>
+#include <robust-equilibrium-lib/matrix_archive.hh>
 #include <robust-equilibrium-lib/logger.hh>
 
 #include <iostream>
@@ -436,6 +438,83 @@ int main()
     cout<<"Check constraint upper bound vector Aub: "<<Aub.isApprox(Aub2)<<endl;
   }
 
+  {
+    cout<<"\nTEST LP CAPTURE\n";
+    const char* filename = "LP_capture.dat";
+    remove(filename);
+    LpCaptureOptions options;
+    options.samplingPeriod = 2;
+    options.captureFailed = false;
+    if(!Solver_LP_abstract::startLpCapture(filename, options))
+    {
+      SEND_ERROR_MSG("Error while starting LP capture");
+      return -1;
+    }
+    Solver_LP_abstract *solverOases = Solver_LP_abstract::getNewSolver(SOLVER_LP_QPOASES);
+    const int n = 3;
+    const int m = 4;
+    const int N_LPS = 10;
+    VectorX c[N_LPS];
+    VectorX lb = -100*VectorX::Ones(n);
+    VectorX ub = 100*VectorX::Ones(n);
+    MatrixXX A = MatrixXX::Random(m,n);
+    VectorX Alb = -100*VectorX::Ones(m);
+    VectorX Aub = 100*VectorX::Ones(m);
+    VectorX sol(n);
+    for(int i=0; i<N_LPS; i++)
+    {
+      c[i] = VectorX::Random(n);
+      solverOases->solve(c[i], lb, ub, A, Alb, Aub, sol);
+    }
+    Solver_LP_abstract::stopLpCapture();
+    delete solverOases;
+
+    vector<CapturedLp> lps;
+    bool res = LpCapture::readFile(filename, lps);
+    cout<<"Check capture file: "<<res<<endl;
+    cout<<"Check number of captured LPs: "<<(lps.size()==N_LPS/2)<<endl;
+    bool ok = true;
+    for(size_t i=0; i<lps.size(); i++)
+      ok = ok && lps[i].c.isApprox(c[2*i]) && lps[i].A.isApprox(A) && lps[i].Aub.isApprox(Aub);
+    cout<<"Check captured LPs: "<<ok<<endl;
+  }
+
+  {
+    cout<<"\nTEST MATRIX ARCHIVE\n";
+    const char* filename = "LP_archive.bin";
+    const int n = 3;
+    const int m = 5;
+    MatrixXX M = MatrixXX::Random(7,4);
+    VectorX c = VectorX::Random(n);
+    VectorX lb = -VectorX::Ones(n);
+    VectorX ub = VectorX::Ones(n);
+    MatrixXX A = MatrixXX::Random(m,n);
+    VectorX Alb = -VectorX::Ones(m);
+    VectorX Aub = VectorX::Ones(m);
+    MatrixArchiveWriter writer;
+    bool res = writer.open(filename);
+    res = res && writer.addMatrix("M", M);
+    res = res && writer.addLp("lp", c, lb, ub, A, Alb, Aub);
+    res = res && !writer.addMatrix("M", M);   // duplicated names are rejected
+    res = writer.close() && res;
+    cout<<"Check archive writing: "<<res<<endl;
+
+    MatrixArchive archive;
+    res = archive.open(filename);
+    cout<<"Check archive opening: "<<res<<endl;
+    cout<<"Check archive entries: "<<(archive.size()==2 && archive.getName(1)=="lp" &&
+                                      archive.getType(1)==ARCHIVE_ENTRY_LP)<<endl;
+    MatrixArchive::MatrixView M_view(NULL, 0, 0);
+    MatrixArchive::LpView lp;
+    res = archive.getMatrix("M", M_view) && M_view.cast<value_type>()==M;
+    res = res && archive.getLp("lp", lp) && lp.c.cast<value_type>()==c && lp.lb.cast<value_type>()==lb &&
+          lp.ub.cast<value_type>()==ub && lp.A.cast<value_type>()==A &&
+          lp.Alb.cast<value_type>()==Alb && lp.Aub.cast<value_type>()==Aub;
+    res = res && !archive.getMatrix("lp", M_view) && !archive.getLp("missing", lp);
+    cout<<"Check archive data: "<<res<<endl;
+    cout<<"Check archive checksums: "<<(archive.verify("M") && archive.verify("lp"))<<endl;
+  }
+
   {
     cout<<"\nTEST QP OASES ON SOME LP PROBLEMS\n";
     string file_path = "../test_data/";
@@ -492,6 +571,25 @@ int main()
       }
     }
 
+    cout<<"\nTEST QP OASES WITH A LIMITED NUMBER OF PROBLEM SIZES\n";
+    Solver_LP_qpoases solverLimited;
+    solverLimited.setMaximumNumberOfProblems(2);
+    bool res = true;
+    // solve the problems twice, so that the solvers of most sizes are deleted and created again
+    for(int k=0; k<2*PROBLEM_NUMBER; k++)
+    {
+      string &problem_filename = problem_filenames[k%PROBLEM_NUMBER];
+      res = res && solverLimited.readLpFromFile(file_path+problem_filename+".dat", c, lb, ub, A, Alb, Aub) &&
+            readMatrixFromFile(file_path+problem_filename+"_solution.dat", realSol);
+      sol.resize(c.size());
+      res = res && solverLimited.solve(c, lb, ub, A, Alb, Aub, sol)==LP_STATUS_OPTIMAL &&
+            fabs(c.dot(sol)-c.dot(realSol))<EPS;
+    }
+    cout<<"Check solutions: "<<res<<endl;
+    solverLimited.clearWarmStartData();
+    res = solverLimited.solve(c, lb, ub, A, Alb, Aub, sol)==LP_STATUS_OPTIMAL && fabs(c.dot(sol)-c.dot(realSol))<EPS;
+    cout<<"Check solution after clearWarmStartData: "<<res<<endl;
+
     return 0;
   }
 
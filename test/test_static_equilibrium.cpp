@@ -5,7 +5,10 @@
 
 #include <vector>
 #include <iostream>
+#include <thread>
 #include <robust-equilibrium-lib/static_equilibrium.hh>
+#include <robust-equilibrium-lib/static_equilibrium_fixed.hh>
+#include <robust-equilibrium-lib/stance_library.hh>
 #include <robust-equilibrium-lib/logger.hh>
 #include <robust-equilibrium-lib/stop-watch.hh>
 
@@ -14,6 +17,8 @@ using namespace Eigen;
 using namespace std;
 
 #define PERF_PP "Polytope Projection"
+#define PERF_IP "Incremental Projection"
+#define PERF_DIP "Dual Incremental Projection"
 #define PERF_LP_PREPARATION "Computation of GIWC generators"
 #define PERF_LP_COIN "Compute Equilibrium Robustness with LP coin"
 #define PERF_LP_OASES "Compute Equilibrium Robustness with LP oases"
@@ -32,13 +37,14 @@ using namespace std;
  * @param PERF_STRING_1 String to use for logging the computation times of solver_1
  * @param PERF_STRING_2 String to use for logging the computation times of solver_2
  * @param verb Verbosity level, 0 print nothing, 1 print summary, 2 print everything
+ * @param e_max Robustness level used to check equilibrium.
  */
 int test_computeEquilibriumRobustness_vs_checkEquilibrium(StaticEquilibrium *solver_1,
                                                           StaticEquilibrium *solver_2,
                                                           Cref_matrixXX comPositions,
                                                           const string& PERF_STRING_1="",
                                                           const string& PERF_STRING_2="",
-                                                          int verb=0)
+                                                          int verb=0, double e_max=0.0)
 {
   int error_counter = 0;
   double rob;
@@ -62,7 +68,7 @@ int test_computeEquilibriumRobustness_vs_checkEquilibrium(StaticEquilibrium *sol
 
     if(!PERF_STRING_2.empty())
       getProfiler().start(PERF_STRING_2);
-    status= solver_2->checkRobustEquilibrium(comPositions.row(i), equilibrium);
+    status= solver_2->checkRobustEquilibrium(comPositions.row(i), equilibrium, e_max);
     if(!PERF_STRING_2.empty())
       getProfiler().stop(PERF_STRING_2);
 
@@ -74,16 +80,16 @@ int test_computeEquilibriumRobustness_vs_checkEquilibrium(StaticEquilibrium *sol
       continue;
     }
 
-    if(equilibrium==true && rob<0.0)
+    if(equilibrium==true && rob<e_max)
     {
       if(verb>1)
-        SEND_ERROR_MSG(solver_2->getName()+" says com is in equilibrium while "+solver_1->getName()+" computed a negative robustness measure "+toString(rob));
+        SEND_ERROR_MSG(solver_2->getName()+" says com is in equilibrium while "+solver_1->getName()+" computed a robustness measure "+toString(rob)+" smaller than "+toString(e_max));
       error_counter++;
     }
-    else if(equilibrium==false && rob>0.0)
+    else if(equilibrium==false && rob>e_max)
     {
       if(verb>1)
-        SEND_ERROR_MSG(solver_2->getName()+" says com is not in equilibrium while "+solver_1->getName()+" computed a positive robustness measure "+toString(rob));
+        SEND_ERROR_MSG(solver_2->getName()+" says com is not in equilibrium while "+solver_1->getName()+" computed a robustness measure "+toString(rob)+" greater than "+toString(e_max));
       error_counter++;
     }
   }
@@ -146,6 +152,163 @@ int test_computeEquilibriumRobustness(StaticEquilibrium *solver_1, StaticEquilib
   return error_counter;
 }
 
+/** Test the batch version of the method StaticEquilibrium::computeEquilibriumRobustness
+ * by comparing its results with the ones of the single-com version.
+ * @param solver Solver to test.
+ * @param comPositions List of 2d com positions on which to perform the tests.
+ * @param PERF_STRING String to use for logging the computation times of the batch evaluation
+ * @param verb Verbosity level, 0 print nothing, 1 print summary, 2 print everything
+ */
+int test_computeEquilibriumRobustness_batch(StaticEquilibrium *solver, Cref_matrixXX comPositions,
+                                            const string& PERF_STRING, int verb=0)
+{
+  int error_counter = 0;
+  VectorX rob_batch(comPositions.rows());
+  vector<LP_status> status_batch;
+
+  getProfiler().start(PERF_STRING);
+  bool res = solver->computeEquilibriumRobustness(comPositions, rob_batch, status_batch);
+  getProfiler().stop(PERF_STRING);
+
+  if(!res)
+  {
+    if(verb>0)
+      SEND_ERROR_MSG(solver->getName()+" failed to compute robustness of batch of com positions");
+    return 1;
+  }
+
+  double rob;
+  LP_status status;
+  for(unsigned int i=0; i<comPositions.rows(); i++)
+  {
+    status = solver->computeEquilibriumRobustness(comPositions.row(i), rob);
+    if(status!=status_batch[i])
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver->getName()+" returned status "+toString(status_batch[i])+" in batch mode and "+
+                       toString(status)+" in single mode for com position "+toString(comPositions.row(i)));
+      error_counter++;
+    }
+    else if(status==LP_STATUS_OPTIMAL && fabs(rob-rob_batch(i))>EPS)
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver->getName()+" returned different results in batch and single mode: "+
+                       toString(rob_batch(i))+" VS "+toString(rob));
+      error_counter++;
+    }
+  }
+
+  if(verb>0)
+    cout<<"Test computeEquilibriumRobustness batch "+solver->getName()+": "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/** Test the method StaticEquilibrium::computeRobustnessMap by comparing its results
+ * with the ones of computeEquilibriumRobustness on a 3d grid.
+ * @param solver Solver to test.
+ * @param com_LB Lower bounds of the 2d com positions of the grid.
+ * @param com_UB Upper bounds of the 2d com positions of the grid.
+ * @param gridSize Number of cells of the grid along x and y.
+ * @param PERF_STRING String to use for logging the computation times of the robustness map
+ * @param verb Verbosity level, 0 print nothing, 1 print summary, 2 print everything
+ */
+int test_computeRobustnessMap(StaticEquilibrium *solver, Cref_vector2 com_LB, Cref_vector2 com_UB,
+                              unsigned int gridSize, const string& PERF_STRING, int verb=0)
+{
+  int error_counter = 0;
+  RobustnessGrid grid;
+  grid.origin << com_LB(0), com_LB(1), 0.5;
+  grid.step << (com_UB(0)-com_LB(0))/(gridSize-1), (com_UB(1)-com_LB(1))/(gridSize-1), 0.2;
+  grid.nx = gridSize;
+  grid.ny = gridSize;
+  grid.nz = 2;
+  VectorX rob_map(grid.size());
+  vector<LP_status> status_map;
+
+  getProfiler().start(PERF_STRING);
+  bool res = solver->computeRobustnessMap(grid, rob_map, status_map);
+  getProfiler().stop(PERF_STRING);
+
+  if(!res)
+  {
+    if(verb>0)
+      SEND_ERROR_MSG(solver->getName()+" failed to compute robustness map");
+    return 1;
+  }
+
+  double rob;
+  LP_status status;
+  Vector3 com;
+  for(unsigned int k=0; k<grid.nz; k++)
+    for(unsigned int j=0; j<grid.ny; j++)
+      for(unsigned int i=0; i<grid.nx; i++)
+      {
+        com = grid.origin + Vector3(i*grid.step(0), j*grid.step(1), k*grid.step(2));
+        status = solver->computeEquilibriumRobustness(com, rob);
+        const long index = grid.index(i,j,k);
+        if(status!=status_map[index])
+        {
+          if(verb>1)
+            SEND_ERROR_MSG(solver->getName()+" returned status "+toString(status_map[index])+" in the map and "+
+                           toString(status)+" in single mode for com position "+toString(com.transpose()));
+          error_counter++;
+        }
+        else if(status==LP_STATUS_OPTIMAL && fabs(rob-rob_map(index))>EPS)
+        {
+          if(verb>1)
+            SEND_ERROR_MSG(solver->getName()+" returned different results in the map and in single mode: "+
+                           toString(rob_map(index))+" VS "+toString(rob));
+          error_counter++;
+        }
+      }
+
+  if(verb>0)
+    cout<<"Test computeRobustnessMap "+solver->getName()+": "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/** Test the batch version of the method StaticEquilibrium::checkRobustEquilibrium
+ * by comparing its results with the ones of the single-com version.
+ * @param solver Solver to test.
+ * @param comPositions List of 2d com positions on which to perform the tests.
+ * @param PERF_STRING String to use for logging the computation times of the batch evaluation
+ * @param verb Verbosity level, 0 print nothing, 1 print summary, 2 print everything
+ */
+int test_checkRobustEquilibrium_batch(StaticEquilibrium *solver, Cref_matrixXX comPositions,
+                                      const string& PERF_STRING, int verb=0)
+{
+  int error_counter = 0;
+  vector<bool> equilibrium_batch;
+
+  getProfiler().start(PERF_STRING);
+  LP_status status = solver->checkRobustEquilibrium(comPositions, equilibrium_batch);
+  getProfiler().stop(PERF_STRING);
+
+  if(status!=LP_STATUS_OPTIMAL)
+  {
+    if(verb>0)
+      SEND_ERROR_MSG(solver->getName()+" failed to check equilibrium of batch of com positions");
+    return 1;
+  }
+
+  bool equilibrium;
+  for(unsigned int i=0; i<comPositions.rows(); i++)
+  {
+    status = solver->checkRobustEquilibrium(comPositions.row(i), equilibrium);
+    if(status!=LP_STATUS_OPTIMAL || equilibrium!=equilibrium_batch[i])
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver->getName()+" returned different results in batch and single mode for com position "+
+                       toString(comPositions.row(i)));
+      error_counter++;
+    }
+  }
+
+  if(verb>0)
+    cout<<"Test checkRobustEquilibrium batch "+solver->getName()+": "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
 /** Test method StaticEquilibrium::findExtremumOverLine. The test works in this way: first it
  * calls the method findExtremumOverLine of the solver to test to find the extremum over a random
  * line with a specified robustness. Then it checks that the point found really has the specified
@@ -225,6 +388,356 @@ int test_findExtremumOverLine(StaticEquilibrium *solver_to_test, StaticEquilibri
   return error_counter;
 }
 
+/** Test method StaticEquilibrium::findExtremumInDirection. The test works in this way: first it
+ * calls the method findExtremumInDirection of the solver to test to find the extremum in a random
+ * direction with a specified robustness. Then it checks that the point found really has the specified
+ * robustness by using the ground-truth solver.
+ * @param solver_to_test Solver to test.
+ * @param solver_ground_truth Second solver to use as ground truth.
+ * @param N_TESTS Number of tests to perform.
+ * @param e_max Maximum value for the desired robustness.
+ * @param PERF_STRING_TEST String to use for logging the computation times of solver_to_test
+ * @param PERF_STRING_GROUND_TRUTH String to use for logging the computation times of solver_ground_truth
+ * @param verb Verbosity level, 0 print nothing, 1 print summary, 2 print everything
+ */
+int test_findExtremumInDirection(StaticEquilibrium *solver_to_test, StaticEquilibrium *solver_ground_truth,
+                                 int N_TESTS, double e_max,
+                                 const string& PERF_STRING_TEST, const string& PERF_STRING_GROUND_TRUTH, int verb=0)
+{
+  int error_counter = 0;
+  Vector3 dir, com;
+  LP_status status;
+  double desired_robustness, robustness;
+  for(unsigned int i=0; i<N_TESTS; i++)
+  {
+    uniform(-1.0*Vector3::Ones(), Vector3::Ones(), dir);
+    dir(2) = 0.0;
+    desired_robustness = (rand()/ value_type(RAND_MAX))*e_max;
+
+    getProfiler().start(PERF_STRING_TEST);
+    status  = solver_to_test->findExtremumInDirection(dir, com, desired_robustness);
+    getProfiler().stop(PERF_STRING_TEST);
+
+    if(status!=LP_STATUS_OPTIMAL)
+    {
+      error_counter++;
+      if(verb>1)
+        SEND_ERROR_MSG(solver_to_test->getName()+" failed to find extremum in direction "+
+                       toString(dir.transpose())+" with robustness "+toString(desired_robustness));
+      continue;
+    }
+
+    getProfiler().start(PERF_STRING_GROUND_TRUTH);
+    status = solver_ground_truth->computeEquilibriumRobustness(com, robustness);
+    getProfiler().stop(PERF_STRING_GROUND_TRUTH);
+
+    if(status!=LP_STATUS_OPTIMAL)
+    {
+      error_counter++;
+      if(verb>1)
+        SEND_ERROR_MSG(solver_ground_truth->getName()+" failed to compute equilibrium robustness of com position "+toString(com.transpose()));
+    }
+    else if(fabs(robustness-desired_robustness)>EPS)
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver_to_test->getName()+" found this extremum: "+toString(com.transpose())+
+                       " in direction "+toString(dir.transpose())+
+                       " which should have robustness "+toString(desired_robustness)+
+                       " but actually has robustness "+toString(robustness));
+      error_counter++;
+    }
+  }
+
+  if(verb>0)
+    cout<<"Test findExtremumInDirection "+solver_to_test->getName()+" VS "+solver_ground_truth->getName()+": "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/** Test that several StaticEquilibrium objects can compute their polytope projection concurrently,
+ * by comparing the results of equilibrium tests with the ones of a solver that projected sequentially.
+ * @param solver_ground_truth PP solver whose contacts have already been set to (p, N, mu).
+ * @param p, N, mu Contact points, contact normals and friction coefficient.
+ * @param comPositions List of 2d com positions on which to perform the tests.
+ * @param N_THREADS Number of threads (and solvers) to use.
+ * @param verb Verbosity level, 0 print nothing, 1 print summary, 2 print everything
+ */
+int test_setNewContacts_concurrent(StaticEquilibrium *solver_ground_truth, double mass,
+                                   unsigned int generatorsPerContact, Cref_matrixX3 p, Cref_matrixX3 N,
+                                   double mu, Cref_matrixXX comPositions, unsigned int N_THREADS, int verb=0)
+{
+  int error_counter = 0;
+  vector<StaticEquilibrium*> solvers(N_THREADS);
+  vector<char> success(N_THREADS, 0);
+  vector<thread> threads;
+  for(unsigned int t=0; t<N_THREADS; t++)
+    solvers[t] = new StaticEquilibrium("PP thread "+toString(t), mass, generatorsPerContact, SOLVER_LP_QPOASES);
+  for(unsigned int t=0; t<N_THREADS; t++)
+    threads.push_back(thread([&, t]()
+    {
+      success[t] = solvers[t]->setNewContacts(p, N, mu, STATIC_EQUILIBRIUM_ALGORITHM_PP);
+    }));
+  for(unsigned int t=0; t<N_THREADS; t++)
+    threads[t].join();
+
+  bool eq, eq_ground_truth;
+  for(unsigned int t=0; t<N_THREADS; t++)
+  {
+    if(!success[t])
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solvers[t]->getName()+" failed to set new contacts");
+      error_counter++;
+      continue;
+    }
+    for(unsigned int i=0; i<comPositions.rows(); i++)
+    {
+      solvers[t]->checkRobustEquilibrium(comPositions.row(i), eq);
+      solver_ground_truth->checkRobustEquilibrium(comPositions.row(i), eq_ground_truth);
+      if(eq!=eq_ground_truth)
+      {
+        if(verb>1)
+          SEND_ERROR_MSG(solvers[t]->getName()+" says equilibrium is "+toString(eq)+" for com position "+
+                         toString(comPositions.row(i))+", while "+solver_ground_truth->getName()+" says "+
+                         toString(eq_ground_truth));
+        error_counter++;
+      }
+    }
+  }
+  for(unsigned int t=0; t<N_THREADS; t++)
+    delete solvers[t];
+
+  if(verb>0)
+    cout<<"Test setNewContacts concurrent "+toString(N_THREADS)+" threads: "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/**
+ * Test the cache of polytopes: two objects sharing the same cache set the same contacts,
+ * so the second one should find the polytope in the cache and give the same results
+ * as the ground truth.
+ * @return The number of errors.
+ */
+int test_polytope_cache(StaticEquilibrium *solver_ground_truth, double mass, unsigned int generatorsPerContact,
+                        Cref_matrixX3 p, Cref_matrixX3 N, double mu, Cref_matrixXX comPositions, int verb=0)
+{
+  int error_counter = 0;
+  PolytopeCache cache;
+  StaticEquilibrium solver_1("PP cache 1", mass, generatorsPerContact, SOLVER_LP_QPOASES);
+  StaticEquilibrium solver_2("PP cache 2", mass, generatorsPerContact, SOLVER_LP_QPOASES);
+  solver_1.setPolytopeCache(&cache);
+  solver_2.setPolytopeCache(&cache);
+  if(!solver_1.setNewContacts(p, N, mu, STATIC_EQUILIBRIUM_ALGORITHM_PP) ||
+     !solver_2.setNewContacts(p, N, mu, STATIC_EQUILIBRIUM_ALGORITHM_PP))
+  {
+    if(verb>1)
+      SEND_ERROR_MSG("Failed to set new contacts with polytope cache");
+    return 1;
+  }
+  if(cache.getNumberOfMisses()!=1 || cache.getNumberOfHits()!=1 || cache.size()!=1)
+  {
+    if(verb>1)
+      SEND_ERROR_MSG("Polytope cache has "+toString(cache.getNumberOfHits())+" hits and "+
+                     toString(cache.getNumberOfMisses())+" misses, while 1 and 1 were expected");
+    error_counter++;
+  }
+
+  bool eq, eq_ground_truth;
+  for(unsigned int i=0; i<comPositions.rows(); i++)
+  {
+    solver_2.checkRobustEquilibrium(comPositions.row(i), eq);
+    solver_ground_truth->checkRobustEquilibrium(comPositions.row(i), eq_ground_truth);
+    if(eq!=eq_ground_truth)
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver_2.getName()+" says equilibrium is "+toString(eq)+" for com position "+
+                       toString(comPositions.row(i))+", while "+solver_ground_truth->getName()+" says "+
+                       toString(eq_ground_truth));
+      error_counter++;
+    }
+  }
+
+  // a budget smaller than the entry evicts it
+  cache.setMemoryBudget(1);
+  if(cache.size()!=0 || cache.getMemoryUsage()!=0 || cache.getNumberOfEvictions()!=1)
+  {
+    if(verb>1)
+      SEND_ERROR_MSG("Polytope cache did not evict its entry");
+    error_counter++;
+  }
+
+  if(verb>0)
+    cout<<"Test polytope cache: "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/**
+ * Save the contact states of the specified solvers in a stance library, load them into new objects
+ * and check that these give the same robustness as the original ones.
+ * @return The number of errors.
+ */
+int test_saveContactState(const vector<StaticEquilibrium*>& solvers, double mass, unsigned int generatorsPerContact,
+                          Cref_matrixXX comPositions, int verb=0)
+{
+  int error_counter = 0;
+  const char* filename = "stance_library.bin";
+  MatrixArchiveWriter writer;
+  bool ok = writer.open(filename);
+  for(size_t s=0; s<solvers.size(); s++)
+    ok = ok && solvers[s]->saveContactState(writer, solvers[s]->getName());
+  ok = writer.close() && ok;
+
+  StanceLibrary library;
+  if(!ok || !library.open(filename) || library.size()!=solvers.size())
+  {
+    if(verb>1)
+      SEND_ERROR_MSG("Error while saving the stance library "+string(filename));
+    return 1;
+  }
+  for(size_t s=0; s<solvers.size(); s++)
+  {
+    StaticEquilibrium loaded(solvers[s]->getName()+" loaded", mass, generatorsPerContact, SOLVER_LP_QPOASES);
+    if(!library.loadStance(solvers[s]->getName(), loaded) || loaded.getAlgorithm()!=solvers[s]->getAlgorithm())
+    {
+      if(verb>1)
+        SEND_ERROR_MSG("Error while loading stance "+solvers[s]->getName());
+      error_counter++;
+      continue;
+    }
+    error_counter += test_computeEquilibriumRobustness(solvers[s], &loaded, comPositions, "", "", verb-1);
+  }
+
+  if(verb>0)
+    cout<<"Test saveContactState: "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/**
+ * Test the incremental projection algorithms on contacts whose support polygon is unbounded:
+ * contacts on the floor and on the ceiling can generate any moment, so every com position is
+ * in equilibrium and IP and DIP must fail instead of returning a bounded polygon.
+ * @return The number of errors.
+ */
+int test_unboundedSupportPolygon(double mass, unsigned int generatorsPerContact, int verb=0)
+{
+  int error_counter = 0;
+  MatrixX3 p(8,3), N(8,3);
+  for(int i=0; i<4; i++)
+  {
+    const double x = (i%2==0) ? -0.1 : 0.1, y = (i<2) ? -0.1 : 0.1;
+    p.row(i) << x, y, 0.0;
+    N.row(i) << 0.0, 0.0, 1.0;
+    p.row(4+i) << x, y, 2.0;
+    N.row(4+i) << 0.0, 0.0, -1.0;
+  }
+  StaticEquilibriumAlgorithm algorithms[] = {STATIC_EQUILIBRIUM_ALGORITHM_IP, STATIC_EQUILIBRIUM_ALGORITHM_DIP};
+  string names[] = {"IP unbounded", "DIP unbounded"};
+  for(int k=0; k<2; k++)
+  {
+    StaticEquilibrium solver(names[k], mass, generatorsPerContact, SOLVER_LP_QPOASES);
+    if(solver.setNewContacts(p, N, 0.5, algorithms[k]))
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver.getName()+" computed a bounded support polygon for contacts in force closure");
+      error_counter++;
+    }
+  }
+
+  StaticEquilibrium solver_LP("LP unbounded", mass, generatorsPerContact, SOLVER_LP_QPOASES);
+  Vector3 com;
+  if(!solver_LP.setNewContacts(p, N, 0.5, STATIC_EQUILIBRIUM_ALGORITHM_LP) ||
+     solver_LP.findExtremumInDirection(Vector3(1.0, 0.0, 0.0), com)!=LP_STATUS_UNBOUNDED)
+  {
+    if(verb>1)
+      SEND_ERROR_MSG(solver_LP.getName()+" did not find the support polygon unbounded");
+    error_counter++;
+  }
+
+  if(verb>0)
+    cout<<"Test unbounded support polygon: "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/**
+ * Build the contacts of solver_ground_truth with a sequence of calls to addContacts and removeContacts,
+ * and check that the resulting object gives the same robustness as solver_ground_truth.
+ * @return The number of errors.
+ */
+int test_addRemoveContacts(StaticEquilibrium *solver_ground_truth, double mass, unsigned int generatorsPerContact,
+                           Cref_matrixXX p, Cref_matrixXX N, double mu, Cref_matrixXX comPositions, int verb=0)
+{
+  StaticEquilibrium solver(solver_ground_truth->getName()+" add/remove contacts", mass, generatorsPerContact,
+                           SOLVER_LP_QPOASES);
+  const long c = p.rows();
+  const long c1 = c/2;
+  // start from the last contacts, add the first ones, then move the last ones at the end again
+  bool ok = solver.setNewContacts(p.bottomRows(c-c1), N.bottomRows(c-c1), mu, solver_ground_truth->getAlgorithm()) &&
+            solver.addContacts(p.topRows(c1), N.topRows(c1)) &&
+            solver.removeContacts(0, c-c1) &&
+            solver.addContacts(p.bottomRows(c-c1), N.bottomRows(c-c1)) &&
+            solver.getNumberOfContacts()==c &&
+            !solver.removeContacts(c1, c);
+  if(!ok)
+  {
+    if(verb>1)
+      SEND_ERROR_MSG("Error while adding and removing contacts of "+solver.getName());
+    return 1;
+  }
+  int error_counter = test_computeEquilibriumRobustness(solver_ground_truth, &solver, comPositions, "", "", verb-1);
+  if(verb>0)
+    cout<<"Test addContacts/removeContacts "+solver_ground_truth->getName()+": "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
+/**
+ * Check that StaticEquilibriumFixed gives the same robustness as the specified solver,
+ * which must use the DLP algorithm.
+ * @return The number of errors.
+ */
+template<int NumGenerators, int MaxContacts>
+int test_StaticEquilibriumFixed(StaticEquilibrium *solver_ground_truth, double mass, Cref_matrixXX p, Cref_matrixXX N,
+                                double mu, Cref_matrixXX comPositions, int verb=0)
+{
+  int error_counter = 0;
+  StaticEquilibriumFixed<NumGenerators, MaxContacts> solver("DLP fixed", mass, SOLVER_LP_QPOASES);
+  if(!solver.setNewContacts(p, N, mu))
+  {
+    if(verb>1)
+      SEND_ERROR_MSG("Error while setting new contacts for solver "+solver.getName());
+    return 1;
+  }
+  // add com positions far from the contacts, which are out of equilibrium
+  const long N_FAR = 4;
+  MatrixXX coms(comPositions.rows()+N_FAR, 3);
+  coms.topRows(comPositions.rows()) = comPositions;
+  const double FAR = 10.0;
+  coms.bottomRows(N_FAR) << FAR, 0.0, 0.0,   -FAR, 0.0, 0.0,   0.0, FAR, 0.0,   0.0, -FAR, 0.0;
+  coms.bottomRows(N_FAR).leftCols<2>().rowwise() += p.leftCols<2>().colwise().mean();
+
+  double rob, rob_ground_truth;
+  for(unsigned int i=0; i<coms.rows(); i++)
+  {
+    rob = rob_ground_truth = 0.0;
+    LP_status status = solver.computeEquilibriumRobustness(coms.row(i), rob);
+    LP_status status_ground_truth = solver_ground_truth->computeEquilibriumRobustness(coms.row(i), rob_ground_truth);
+    if(status!=status_ground_truth || (status==LP_STATUS_OPTIMAL && fabs(rob-rob_ground_truth)>EPS))
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver.getName()+" and "+solver_ground_truth->getName()+" returned different results: "+
+                       toString(status)+" "+toString(rob)+" VS "+toString(status_ground_truth)+" "+toString(rob_ground_truth));
+      error_counter++;
+    }
+    else if(i>=comPositions.rows() && status==LP_STATUS_OPTIMAL && rob>=0.0)
+    {
+      if(verb>1)
+        SEND_ERROR_MSG(solver.getName()+" says com position "+toString(coms.row(i))+" is in equilibrium");
+      error_counter++;
+    }
+  }
+  if(verb>0)
+    cout<<"Test StaticEquilibriumFixed VS "+solver_ground_truth->getName()+": "+toString(error_counter)+" error(s).\n";
+  return error_counter;
+}
+
 /** Draw a grid on the screen using the robustness computed with the method
  *  StaticEquilibrium::computeEquilibriumRobustness.
  * @param solver The solver to use for computing the equilibrium robustness.
@@ -462,6 +975,8 @@ int main()
   cout<<"Gonna test equilibrium on a 2d grid of "<<GRID_SIZE<<"X"<<GRID_SIZE<<" points "<<endl;
 
   StaticEquilibrium* solver_PP = new StaticEquilibrium("PP", mass, generatorsPerContact, SOLVER_LP_QPOASES);
+  StaticEquilibrium* solver_IP = new StaticEquilibrium("IP", mass, generatorsPerContact, SOLVER_LP_QPOASES);
+  StaticEquilibrium* solver_DIP = new StaticEquilibrium("DIP", mass, generatorsPerContact, SOLVER_LP_QPOASES);
   StaticEquilibrium* solvers[N_SOLVERS];
   for(int s=0; s<N_SOLVERS; s++)
     solvers[s] = new StaticEquilibrium(solverNames[s], mass, generatorsPerContact, lp_solver_types[s]);
@@ -494,6 +1009,22 @@ int main()
     }
     getProfiler().stop(PERF_PP);
 
+    getProfiler().start(PERF_IP);
+    if(!solver_IP->setNewContacts(p, N, mu, STATIC_EQUILIBRIUM_ALGORITHM_IP))
+    {
+      SEND_ERROR_MSG("Error while setting new contacts for solver "+solver_IP->getName());
+      return -1;
+    }
+    getProfiler().stop(PERF_IP);
+
+    getProfiler().start(PERF_DIP);
+    if(!solver_DIP->setNewContacts(p, N, mu, STATIC_EQUILIBRIUM_ALGORITHM_DIP))
+    {
+      SEND_ERROR_MSG("Error while setting new contacts for solver "+solver_DIP->getName());
+      return -1;
+    }
+    getProfiler().stop(PERF_DIP);
+
     // compute upper and lower bounds of com positions to test
     com_LB(0) = p.col(0).minCoeff()-X_MARG;
     com_UB(0) = p.col(0).maxCoeff()+X_MARG;
@@ -530,6 +1061,36 @@ int main()
       test_computeEquilibriumRobustness_vs_checkEquilibrium(solvers[s], solver_PP, comPositions,
           test_name+solvers[s]->getName(), "", 1);
     }
+    test_computeEquilibriumRobustness_vs_checkEquilibrium(solver_PP, solver_PP, comPositions,
+        test_name+solver_PP->getName(), "", 1);
+    test_checkRobustEquilibrium_batch(solver_PP, comPositions, "Check equilibrium batch PP", 1);
+    test_setNewContacts_concurrent(solver_PP, mass, generatorsPerContact, p, N, mu, comPositions, 4, 1);
+    test_polytope_cache(solver_PP, mass, generatorsPerContact, p, N, mu, comPositions, 1);
+    vector<StaticEquilibrium*> saved_solvers;
+    saved_solvers.push_back(solvers[0]);
+    saved_solvers.push_back(solver_PP);
+    test_saveContactState(saved_solvers, mass, generatorsPerContact, comPositions, 1);
+    test_addRemoveContacts(solvers[0], mass, generatorsPerContact, p, N, mu, comPositions, 1);
+    test_addRemoveContacts(solver_PP, mass, generatorsPerContact, p, N, mu, comPositions, 1);
+    if(generatorsPerContact==4)
+      test_StaticEquilibriumFixed<4,8>(solvers[2], mass, p, N, mu, comPositions, 1);
+    test_computeEquilibriumRobustness_vs_checkEquilibrium(solvers[0], solver_IP, comPositions, "", "", 1);
+    test_computeEquilibriumRobustness_vs_checkEquilibrium(solvers[0], solver_DIP, comPositions, "", "", 1);
+    test_unboundedSupportPolygon(mass, generatorsPerContact, 1);
+
+    for(int s=0; s<N_SOLVERS; s++)
+    {
+      test_computeEquilibriumRobustness_batch(solvers[s], comPositions,
+          "Compute equilibrium robustness batch "+solvers[s]->getName(), 1);
+    }
+
+    for(int s=0; s<N_SOLVERS; s++)
+    {
+      test_computeRobustnessMap(solvers[s], com_LB.transpose(), com_UB.transpose(), 3*GRID_SIZE,
+          "Compute robustness map "+solvers[s]->getName(), 1);
+    }
+    test_computeRobustnessMap(solver_PP, com_LB.transpose(), com_UB.transpose(), 3*GRID_SIZE,
+        "Compute robustness map PP", 1);
 
     const int N_TESTS_EXTREMUM = 100;
     Vector3 a0 = Vector3::Zero();
@@ -548,6 +1109,16 @@ int main()
           test_findExtremumOverLine(solvers[s], solvers[0], a0, N_TESTS_EXTREMUM, e_max, test_name+solvers[s]->getName(),
               test_name2+solvers[0]->getName(), 1);
       }
+
+      test_computeEquilibriumRobustness_vs_checkEquilibrium(solvers[0], solver_PP, comPositions, "", "", 1, 0.5*e_max);
+
+      test_name = "EXTREMUM IN DIRECTION ";
+      for(int s=0; s<N_SOLVERS; s++)
+      {
+        if(solvers[s]->getAlgorithm()!=STATIC_EQUILIBRIUM_ALGORITHM_LP2)
+          test_findExtremumInDirection(solvers[s], solvers[0], N_TESTS_EXTREMUM, e_max, test_name+solvers[s]->getName(),
+              test_name2+solvers[0]->getName(), 1);
+      }
     }
   }
 